@@ -15,6 +15,7 @@
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
 #include <LittleFS.h>
+#include <hardware/irq.h>
 
 // Pin Definitions
 #define SHIFT_PIN 3
@@ -57,30 +58,45 @@ const int CHORD_PAD_BUTTONS[NUM_CHORD_PADS] = {0, 1, 2, 4, 5, 6, 8, 9, 10};
 
 // Hardware objects
 Adafruit_NeoPixel pixels(NUM_PIXELS, NEOPIXEL_PIN, NEO_GRB + NEO_KHZ800);
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, 400000UL, 400000UL);  // Stay at 400kHz between transfers
 Adafruit_USBD_MIDI usb_midi;
 
+#include "midiOutV2.h"
+#include "midiInV2.h"
+#include "clockV2.h"
+#include "schedulerV2.h"
+#include "displayV2.h"
+#include "ledsV2.h"
+#include "ledAnimV2.h"
+#include "keysV2.h"
+
+// MIDI output queues (DIN + USB)
+MidiOutPort midiOutPorts[NUM_MIDI_OUT_PORTS];
+
 // Include V2 headers after struct definitions needed
 #include "musicTheoryV2.h"
 #include "presetV2.h"
 #include "specialModesV2.h"
 
-// Forward declarations for looper helper functions (defined later, used by looperV2.h)
-int getLooperOutputChannel();
-int looperFindPadForNoteImpl(uint8_t note);
-
+#include "voicesV2.h"
 #include "looperV2.h"
+#include "smfV2.h"
+#include "smfExportV2.h"
+#include "looperFileV2.h"
 
 // Looper state (global)
 LooperState looper;
+LoopStore loopStore;
+LoopFileJob loopFile;
+
+// Sounding notes (see voicesV2.h)
+VoiceTable voices;
 
 // Key state arrays
 bool shiftState = false;
 bool previousShiftState = false;
 bool encoderState = false;
 bool previousEncoderState = false;
-unsigned long encoderDebounceTime = 0; // Last state change time
-#define ENCODER_DEBOUNCE_MS 20         // Debounce lockout (ms)
 bool keyStates[16] = {false};
 bool previousKeyStates[16] = {false};
 bool padStates[9] = {false};
@@ -92,24 +108,10 @@ volatile int lastEncoded = 0;
 volatile int stepCounter = 0;
 const int encoderStates[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
 
-// MIDI state machine
-enum MIDIState {
-  WAITING_FOR_STATUS,
-  WAITING_FOR_DATA1,
-  WAITING_FOR_DATA2
-};
-
-volatile uint8_t midiStatus = 0;
-volatile uint8_t midiData1 = 0;
-volatile uint8_t midiData2 = 0;
-volatile MIDIState currentMidiState = WAITING_FOR_STATUS;
-volatile bool midiMessageReady = false;
-
-// Note reference counting (4 channels)
-int noteCountA[128] = {0};
-int noteCountB[128] = {0};
-int noteCountC[128] = {0};
-int noteCountD[128] = {0};
+// MIDI input parsers (one per source, see midiInV2.h)
+MidiParser dinParser;
+MidiParser usbParser;
+MidiRxRing dinRxRing;                // Filled by midiInterruptHandler
 
 // V2 Settings
 struct SettingsV2 {
@@ -160,6 +162,26 @@ const char* arpOctaveNames[NUM_ARP_OCTAVES] = {
   "Off", "+1", "+2", "+3", "+4", "+5", "-1", "-2", "+/-1"
 };
 
+// Looper file actions
+#define NUM_LOOPER_FILE_ACTIONS 4
+const char* looperFileActionNames[NUM_LOOPER_FILE_ACTIONS] = {
+  "SAVE", "LOAD", "MIDI 0", "MIDI 1"
+};
+
+// Looper record quantize (indexed by LOOP_QUANTIZE_*)
+const char* loopQuantizeNames[NUM_LOOP_QUANTIZE] = {
+  "OFF", "TICK", "1/16", "1/8"
+};
+
+// Looper track lengths (indexed by LOOP_LENGTH_*) and the order the menu steps through them
+const char* loopLengthNames[NUM_LOOP_LENGTHS] = {
+  "1 BAR", "2 BARS", "4 BARS", "FREE", "8 BARS", "16 BARS"
+};
+const uint8_t loopLengthMenuOrder[NUM_LOOP_LENGTHS] = {
+  LOOP_LENGTH_1_BAR, LOOP_LENGTH_2_BARS, LOOP_LENGTH_4_BARS,
+  LOOP_LENGTH_8_BARS, LOOP_LENGTH_16_BARS, LOOP_LENGTH_FREE
+};
+
 // V2 Runtime state
 struct RuntimeState {
   int currentOctave = 0;          // -3 to +3
@@ -177,6 +199,10 @@ struct RuntimeState {
   bool inArpSettings = false;     // Arp settings mode (toggle with button 11)
   bool arpSettingsEditing = false; // True when editing a value in arp settings
   bool inMaxNotesMenu = false;    // Max notes menu (toggle with Shift+7)
+  bool inLooperMenu = false;      // Looper track menu (toggle with Shift+Arp-)
+  bool looperMenuEditing = false; // True when editing a value in the looper menu
+  int looperMenuPage = 0;         // Looper menu item: 0=Track, 1=Length, 2=Channel, 3=Mute, 4=Solo, 5=Layer, 6=Quantize, 7=File
+  int looperFileAction = 0;       // File item: 0=Save, 1=Load, 2=MIDI type 0, 3=MIDI type 1
   int settingsPage = 0;           // Settings menu item index
   int arpSettingsPage = 0;        // Arp settings page: 0=Pattern, 1=Gate, 2=Swing, 3=Humanize, 4=Velocity, 5=Octave, 6=Mode, 7=Chords
   bool latchMode = false;         // LATCH mode - sustain notes after releasing pad
@@ -202,17 +228,19 @@ unsigned long lastMutationFlash = 0;  // For LED flash on mutation
 volatile bool midiClockReceived = false;    // Flag set by interrupt when clock pulse received
 volatile int midiClockCounter = 0;          // Counts clock pulses (24 PPQN)
 volatile bool midiTransportRunning = false; // Start/Stop state
-volatile unsigned long lastClockTime = 0;   // For detecting clock presence
 volatile int arpClockCount = 0;             // Counts clocks since last arp trigger (for sync)
 bool externalClockActive = false;           // True when receiving valid external clock
 bool clockPulseIndicator = false;           // Blinks on each clock pulse for visual feedback
 unsigned long lastClockPulseTime = 0;       // For clock indicator timing
 
 // BPM detection and internal clock
-volatile unsigned long lastClockMicros = 0; // For BPM calculation
-volatile unsigned long clockIntervalMicros = 0; // Average interval between clocks
-int detectedBpm = 0;                        // Calculated BPM from external clock
-unsigned long lastInternalClockTime = 0;    // For internal clock generation
+ClockTracker clockTracker;                  // Tracks external clock from DIN or USB
+int detectedBpm = 0;                        // Tracked BPM of the external clock
+InternalClock internalClock;                // Hardware-timer clock master when no external clock
+Scheduler scheduler;                        // Timed note-offs, delayed arp steps, glide release
+DisplayFlushState displayFlushState;        // Shadow of the panel for changed-bytes-only updates
+LedOutput ledOutput;                        // PIO/DMA NeoPixel output, skips unchanged frames
+KeyScanner keyScanner;                      // Timer-driven matrix scan + key event queue
 int internalClockCounter = 0;               // Internal clock pulse counter
 
 // Arpeggiator note tracking (to prevent stuck notes)
@@ -221,6 +249,7 @@ int lastArpNoteIndex = -1;                  // Which note index was last played
 int lastArpNoteMidi = -1;                   // Actual MIDI note number that was played (with octave shift)
 int lastArpNoteChannel = 0;                 // Channel used for last note
 bool arpNotePlaying = false;                // Is an arp note currently sounding
+uint8_t arpStepId = 0;                      // Tags chord-mode gate callbacks with their step
 
 // Poly arp mode - combined note pool from multiple pads
 int polyArpPads[72];                        // Which pad each note comes from (9 pads * 8 notes)
@@ -233,6 +262,21 @@ SettingsV2 settings;
 RuntimeState state;
 PadV2 pads[9];
 
+#include "chordCacheV2.h"
+#include "uiV2.h"
+#include "settingsSchemaV2.h"
+#include "settingsJournalV2.h"
+
+// Resolved notes/channels per pad (see chordCacheV2.h)
+ChordCache chordCache;
+
+// Write-behind settings storage (see settingsJournalV2.h)
+SettingsJournal settingsJournal;
+
+// Core0 -> core1 UI state (see uiV2.h)
+UiSnapshotBuffer uiSnapshots;
+ScreensaverState screensaverAnim;           // Cyber Rain animation, owned by core1
+
 // Animation state
 unsigned long animStartTime = 0;
 int animPhase = 0;
@@ -248,6 +292,7 @@ void setup() {
 
   pinMode(RX_PIN, INPUT_PULLUP);
   Serial1.begin(31250);
+  initMidiUart();         // Take over the UART IRQ for timestamped RX / queued TX
 
   // Seed random number generator for humanize/random patterns
   randomSeed(analogRead(A0) + micros());
@@ -255,6 +300,9 @@ void setup() {
   // Initialize screensaver timer
   screensaver.lastInputTime = millis();
 
+  voicesInit(voices);
+  initLooper();
+
   if (!LittleFS.begin()) {
     // LittleFS failed - continue anyway
   }
@@ -277,14 +325,67 @@ void loop() {
   // Main V2 loop
   checkKeys();
   updateMIDI();
+  updateScheduler();      // Bookkeeping for events the scheduler has already sent
   updateInternalClock();  // Generate internal clock when no external
   updateArpeggiator();
   updateLooper();         // Update looper playback/LED timing
+  updateLooperFile(flashWriteGap());  // Next chunk of a loop save/load/export
+  updateSettingsJournal(settingsJournal, settings,   // Deferred settings write, in a gap
+                        settingsWriteGap(), !looper.playing);
   updateGenerativeMode(); // Mutate notes in generative mode
   updateGlide();          // Animate pitch bend glide
+  midiOutService();       // Flush this pass's MIDI as one USB batch
   checkScreensaver();     // Check for idle timeout
-  updateVisuals();
-  updateDisplay();
+  publishUiSnapshot();    // LEDs and OLED are drawn on core1 from this
+}
+
+//================================ CORE 1 (UI) ================================
+
+void setup1() {
+  // Core0 owns the display and LEDs until the intro is over
+  while (!uiSnapshots.enabled) {
+    delay(1);
+  }
+}
+
+void loop1() {
+  // Frame cap - nothing is drawn or sent between frames
+  if (!displayFrameDue(displayFlushState)) {
+    return;
+  }
+
+  // Ask core0 for the current state (it answers within one loop() pass)
+  const UiSnapshot* ui;
+  while ((ui = uiSnapshotTake(uiSnapshots)) == NULL) {
+  }
+
+  updateVisuals(*ui);
+  updateDisplay(*ui);
+}
+
+// Copy what the renderers need when core1 asks for it
+void publishUiSnapshot() {
+  if (!uiSnapshotWanted(uiSnapshots)) return;
+
+  UiSnapshot& ui = uiSnapshotBack(uiSnapshots);
+  ui.settings = settings;
+  ui.state = state;
+  memcpy(ui.pads, pads, sizeof(pads));
+  if (state.activePad >= 0) ui.activeChord = padChord(state.activePad);
+  ui.looper = looper;
+  if (looper.hasContent || looper.recording || looper.overdubbing) looperBuildView(ui.looperView);
+  memcpy(ui.padStates, padStates, sizeof(padStates));
+  memcpy(ui.keyStates, keyStates, sizeof(keyStates));
+  ui.shiftState = shiftState;
+  ui.screensaverActive = screensaver.active;
+  ui.externalClockActive = externalClockActive;
+  ui.clockPulseIndicator = clockPulseIndicator;
+  ui.lastClockPulseTime = lastClockPulseTime;
+  ui.lastMutationFlash = lastMutationFlash;
+  ui.detectedBpm = detectedBpm;
+  ui.clockBeatPhase = clockTrackerBeatPhase(clockTracker, micros());
+  ui.clockJitterUs = clockTrackerJitterUs(clockTracker);
+  uiSnapshotPublish(uiSnapshots);
 }
 
 //================================ HARDWARE INIT ================================
@@ -309,13 +410,13 @@ void initHardware() {
   // Interrupts
   attachInterrupt(digitalPinToInterrupt(ENCODER_A), updateEncoder, CHANGE);
   attachInterrupt(digitalPinToInterrupt(ENCODER_B), updateEncoder, CHANGE);
-  attachInterrupt(digitalPinToInterrupt(RX_PIN), midiInterruptHandler, FALLING);
 
   // NeoPixels
   pixels.begin();
   pixels.setBrightness(100);
   pixels.clear();
-  pixels.show();
+  ledsInit(ledOutput, NEOPIXEL_PIN);  // PIO + DMA take over the pin
+  ledsShow(ledOutput, pixels);
 
   // OLED Display
   display.setRotation(2);
@@ -373,7 +474,7 @@ void updateIntroAnimation() {
     pixels.setPixelColor(pixelTarget, 0xFF0000); // Red center
     if(pixelTarget > 0) pixels.setPixelColor(pixelTarget-1, 0x440000);
     if(pixelTarget < 16) pixels.setPixelColor(pixelTarget+1, 0x440000);
-    pixels.show();
+    ledsShow(ledOutput, pixels);
   }
   // Phase 2: The Pulse / Stabilization (2200-3000ms) - Slower fade
   else if (elapsed < 3000) {
@@ -397,17 +498,20 @@ void updateIntroAnimation() {
     display.print("V2.1 READY");
 
     // LEDs: Cyan explosion fading out slowly
-    float brightness = map(elapsed, 2200, 3000, 255, 0) / 255.0;
+    uint16_t brightness = map(elapsed, 2200, 3000, LED_LEVEL_FULL, 0);
     pixels.clear();
     for(int i=0; i<NUM_PIXELS; i++) {
-      pixels.setPixelColor(i, dimColor(0x00FFFF, brightness));
+      pixels.setPixelColor(i, ledScale(0x00FFFF, brightness));
     }
-    pixels.show();
+    ledsShow(ledOutput, pixels);
   }
   // Done
   else {
     state.introComplete = true;
     display.invertDisplay(false);
+    displayFlushInvalidate(displayFlushState);  // Intro used full display() transfers
+    uiSnapshots.enabled = true;                 // Hand display and LEDs to core1
+    keysInit(keyScanner);                       // Start scanning - keys held now arrive as presses
     encoderValue = 0;
   }
 
@@ -418,6 +522,7 @@ void updateIntroAnimation() {
 //================================ KEY SCANNING ================================
 
 void checkKeys() {
+  // Edges are relative to the last pass (or the last event handled below)
   previousShiftState = shiftState;
   previousEncoderState = encoderState;
   for (int i = 0; i < 16; i++) {
@@ -427,46 +532,44 @@ void checkKeys() {
     previousPadStates[i] = padStates[i];
   }
 
-  shiftState = !digitalRead(SHIFT_PIN);
-
-  // Debounced encoder button reading - respond immediately, debounce prevents bounce
-  bool rawReading = !digitalRead(ENCODER_S);
-  // Only accept state changes if enough time has passed (debounce lockout)
-  if ((millis() - encoderDebounceTime) > ENCODER_DEBOUNCE_MS) {
-    if (rawReading != encoderState) {
-      encoderState = rawReading;         // Respond immediately
-      encoderDebounceTime = millis();    // Start lockout period
+  // Handle queued key events one at a time so a press and release that both
+  // happened since the last pass are each seen as an edge
+  bool anyInput = false;
+  KeyEvent evt;
+  while (keysPopEvent(keyScanner, evt)) {
+    if (evt.key == KEY_SHIFT) {
+      shiftState = evt.pressed;
+    } else if (evt.key == KEY_ENCODER) {
+      encoderState = evt.pressed;
+    } else {
+      keyStates[evt.key] = evt.pressed;
     }
-  }
+    anyInput = true;
 
-  // Scan key matrix
-  for (int row = 0; row < 4; row++) {
-    digitalWrite(ROW0_PIN, row == 0 ? LOW : HIGH);
-    digitalWrite(ROW1_PIN, row == 1 ? LOW : HIGH);
-    digitalWrite(ROW2_PIN, row == 2 ? LOW : HIGH);
-    digitalWrite(ROW3_PIN, row == 3 ? LOW : HIGH);
+    // Notes this key starts or stops are recorded at the edge, not now
+    looper.inputTimed = true;
+    looper.inputTimeUs = evt.time;
+    processButtonPresses();
+    processPadChanges();
+    looper.inputTimed = false;
 
-    for (int col = 0; col < 4; col++) {
-      int keyIndex = row * 4 + col;
-      keyStates[keyIndex] = !digitalRead(COL0_PIN + col);
+    previousShiftState = shiftState;
+    previousEncoderState = encoderState;
+    for (int i = 0; i < 16; i++) {
+      previousKeyStates[i] = keyStates[i];
+    }
+    for (int i = 0; i < 9; i++) {
+      previousPadStates[i] = padStates[i];
     }
   }
-  digitalWrite(ROW3_PIN, HIGH);
 
-  // Process button presses
-  processButtonPresses();
+  // No key events - still handle encoder turns
+  if (!anyInput) {
+    processButtonPresses();
+  }
 
   // Check for any input activity to reset screensaver
-  bool anyInput = false;
-  if (encoderState != previousEncoderState) anyInput = true;
-  if (shiftState != previousShiftState) anyInput = true;
   if (encoderValue != 0) anyInput = true;
-  for (int i = 0; i < 16; i++) {
-    if (keyStates[i] != previousKeyStates[i]) {
-      anyInput = true;
-      break;
-    }
-  }
   if (anyInput) {
     resetScreensaver();
   }
@@ -660,6 +763,83 @@ void processButtonPresses() {
     }
   }
 
+  // Handle looper track menu (Shift+Arp-)
+  // Items: 0=Track, 1=Length, 2=Channel, 3=Mute, 4=Solo - all for the selected track
+  //        5=Layer - turn left to undo the newest overdub, right to redo
+  //        6=Quantize - record quantize, all tracks
+  //        7=File - pick save/load/MIDI export, leaving edit runs it
+  // Click to edit, click to exit edit (same as arp settings)
+  #define NUM_LOOPER_MENU_ITEMS 8
+  if (state.inLooperMenu) {
+    if (state.looperMenuEditing) {
+      // EDITING MODE - encoder changes value, click exits edit
+      if (encoderState && !previousEncoderState) {
+        state.looperMenuEditing = false;
+        if (state.looperMenuPage == 7) {
+          switch (state.looperFileAction) {
+            case 0: looperFileStartSave(); break;
+            case 1: looperFileStartLoad(); break;
+            case 2: looperFileStartExport(SMF_FORMAT_SINGLE, externalClockActive ? detectedBpm : settings.internalBpm); break;
+            case 3: looperFileStartExport(SMF_FORMAT_MULTI, externalClockActive ? detectedBpm : settings.internalBpm); break;
+          }
+        }
+      }
+      if (encoderValue != 0) {
+        uint8_t track = looper.selectedTrack;
+        const LoopTrack& tr = looper.tracks[track];
+        int dir = (encoderValue > 0) ? 1 : -1;
+        switch (state.looperMenuPage) {
+          case 0: // Track
+            looperSelectTrack((track + dir + LOOP_TRACKS) % LOOP_TRACKS);
+            break;
+          case 1: { // Length, in menu order
+            int pos = 0;
+            while (pos < NUM_LOOP_LENGTHS && loopLengthMenuOrder[pos] != tr.lengthBars) pos++;
+            pos = constrain(pos + dir, 0, NUM_LOOP_LENGTHS - 1);
+            looperSetTrackLength(track, loopLengthMenuOrder[pos]);
+            break;
+          }
+          case 2: { // Channel: AS REC, then 1-16
+            int ch = (tr.channel == LOOP_CHANNEL_AS_RECORDED) ? -1 : tr.channel;
+            ch = constrain(ch + dir, -1, 15);
+            looperSetTrackChannel(track, ch < 0 ? LOOP_CHANNEL_AS_RECORDED : ch);
+            break;
+          }
+          case 3: // Mute
+            looperSetTrackMute(track, !tr.muted);
+            break;
+          case 4: // Solo
+            looperSetTrackSolo(track, !tr.soloed);
+            break;
+          case 5: // Layer undo/redo
+            if (dir < 0) {
+              looperUndo();
+            } else {
+              looperRedo();
+            }
+            break;
+          case 6: // Quantize
+            looper.quantize = constrain(looper.quantize + dir, 0, NUM_LOOP_QUANTIZE - 1);
+            break;
+          case 7: // File action
+            state.looperFileAction = (state.looperFileAction + dir + NUM_LOOPER_FILE_ACTIONS) % NUM_LOOPER_FILE_ACTIONS;
+            break;
+        }
+        encoderValue = 0;
+      }
+    } else {
+      // NAVIGATION MODE - encoder scrolls menu, click enters edit
+      if (encoderState && !previousEncoderState) {
+        state.looperMenuEditing = true;
+      }
+      if (encoderValue != 0) {
+        state.looperMenuPage = (state.looperMenuPage + (encoderValue > 0 ? 1 : -1) + NUM_LOOPER_MENU_ITEMS) % NUM_LOOPER_MENU_ITEMS;
+        encoderValue = 0;
+      }
+    }
+    // DON'T return - pads keep playing so the selected track can be recorded
+  }
+
   // Handle arp settings mode
   // Pages: 0=Pattern, 1=Gate, 2=Swing, 3=Humanize, 4=VelVar, 5=Octave, 6=Mode, 7=PlayChords
   // Click to edit, click to exit edit (same as main settings)
@@ -791,7 +971,7 @@ void processButtonPresses() {
   }
 
   // Encoder navigation - changes based on mode
-  if (!state.inSettingsMode && !state.inArpSettings && !state.inMaxNotesMenu) {
+  if (!state.inSettingsMode && !state.inArpSettings && !state.inMaxNotesMenu && !state.inLooperMenu) {
     if (encoderValue != 0) {
       // In preset mode: encoder scrolls through presets
       if (state.inPresetMode) {
@@ -1014,6 +1194,7 @@ void processButtonPresses() {
       if (state.inSpecialModeMenu) {
         state.inSpecialModeMenu = false;
       }
+      state.inLooperMenu = false;
       state.inArpSettings = !state.inArpSettings;
       state.arpSettingsPage = 0;
       state.arpSettingsEditing = false;
@@ -1027,9 +1208,18 @@ void processButtonPresses() {
     }
   }
 
-  // Arp- button (no shift function)
+  // Arp- button
+  // Shift + Arp- = toggle Looper track menu
   if (keyStates[BTN_ARP_DOWN] && !previousKeyStates[BTN_ARP_DOWN]) {
-    if (!shiftState) {  // Only if not holding shift
+    if (shiftState) {
+      if (state.inArpSettings) {
+        state.inArpSettings = false;
+        saveSettings();
+      }
+      state.inLooperMenu = !state.inLooperMenu;
+      state.looperMenuPage = 0;
+      state.looperMenuEditing = false;
+    } else {
       stopCurrentArpNote();
       state.arpRate = constrain(state.arpRate - 1, 0, 6);
       if (state.arpRate == 0) {
@@ -1044,109 +1234,25 @@ void processButtonPresses() {
 //================================ MIDI PROCESSING ================================
 
 void updateMIDI() {
-  // Poll Serial1 for MIDI data (more reliable than interrupt for clock)
-  while (Serial1.available()) {
-    uint8_t inByte = Serial1.read();
-
-    // Handle real-time messages immediately (single byte, 0xF8-0xFF)
-    if (inByte >= 0xF8) {
-      switch (inByte) {
-        case 0xF8:  // MIDI Clock (24 PPQN)
-          {
-            midiClockReceived = true;
-            midiClockCounter++;
-            arpClockCount++;  // Count for arpeggiator sync
-            lastClockTime = millis();
-
-            // Calculate BPM from clock interval (average over 24 clocks = 1 beat)
-            unsigned long now = micros();
-            if (lastClockMicros > 0) {
-              // Smooth averaging of clock intervals
-              unsigned long interval = now - lastClockMicros;
-              if (clockIntervalMicros == 0) {
-                clockIntervalMicros = interval;
-              } else {
-                clockIntervalMicros = (clockIntervalMicros * 7 + interval) / 8;  // Smoothing
-              }
-              // BPM = 60,000,000 / (interval_micros * 24)
-              if (clockIntervalMicros > 0) {
-                detectedBpm = 60000000UL / (clockIntervalMicros * 24);
-                detectedBpm = constrain(detectedBpm, 20, 300);
-              }
-            }
-            lastClockMicros = now;
-
-            // Visual indicator - pulse every beat (every 24 clocks)
-            if (midiClockCounter % 24 == 0) {
-              clockPulseIndicator = true;
-              lastClockPulseTime = millis();
-            }
+  MidiEvent evt;
 
-            // Advance looper on each clock tick
-            looperClockTick();
-          }
-          break;
-        case 0xFA:  // Start
-          midiTransportRunning = true;
-          midiClockCounter = 0;
-          break;
-        case 0xFB:  // Continue
-          midiTransportRunning = true;
-          break;
-        case 0xFC:  // Stop
-          midiTransportRunning = false;
-          break;
-      }
-      continue;  // Don't process as regular MIDI
-    }
-
-    // Handle regular MIDI messages via state machine
-    switch (currentMidiState) {
-      case WAITING_FOR_STATUS:
-        if (inByte >= 0x80 && inByte < 0xF0) {
-          midiStatus = inByte;
-          currentMidiState = WAITING_FOR_DATA1;
-        }
-        break;
-      case WAITING_FOR_DATA1:
-        midiData1 = inByte;
-        currentMidiState = WAITING_FOR_DATA2;
-        break;
-      case WAITING_FOR_DATA2:
-        midiData2 = inByte;
-        processIncomingMIDI(midiStatus, midiData1, midiData2);
-        currentMidiState = WAITING_FOR_STATUS;
-        break;
+  // DIN bytes were captured (with arrival time) by midiInterruptHandler
+  uint8_t inByte;
+  uint32_t inTime;
+  while (midiRxRingPop(dinRxRing, inByte, inTime)) {
+    if (midiParserFeed(dinParser, inByte, evt)) {
+      handleMidiEvent(evt, MIDI_SOURCE_DIN, inTime);
     }
   }
 
-  // Check for incoming USB MIDI
-  while (usb_midi.available()) {
-    uint32_t packet = usb_midi.read();
-    uint8_t status = (packet >> 8) & 0xFF;
-    uint8_t data1 = (packet >> 16) & 0xFF;
-    uint8_t data2 = (packet >> 24) & 0xFF;
-
-    // Handle USB MIDI clock too
-    if (status == 0xF8) {
-      midiClockReceived = true;
-      midiClockCounter++;
-      arpClockCount++;  // Count for arpeggiator sync
-      lastClockTime = millis();
-      if (midiClockCounter % 24 == 0) {
-        clockPulseIndicator = true;
-        lastClockPulseTime = millis();
+  // Check for incoming USB MIDI - unpack event packets through the same parser
+  uint8_t packet[4];
+  while (usb_midi.readPacket(packet)) {
+    uint8_t count = midiUsbPacketLength(packet[0] & 0x0F);
+    for (uint8_t i = 0; i < count; i++) {
+      if (midiParserFeed(usbParser, packet[1 + i], evt)) {
+        handleMidiEvent(evt, MIDI_SOURCE_USB, micros());
       }
-      looperClockTick();  // Advance looper
-    } else if (status == 0xFA) {
-      midiTransportRunning = true;
-      midiClockCounter = 0;
-    } else if (status == 0xFB) {
-      midiTransportRunning = true;
-    } else if (status == 0xFC) {
-      midiTransportRunning = false;
-    } else {
-      processIncomingMIDI(status, data1, data2);
     }
   }
 
@@ -1155,7 +1261,13 @@ void updateMIDI() {
     clockPulseIndicator = false;
   }
 
-  // Process pad state changes
+  // Pad changes from incoming MIDI (and anything processButtonPresses
+  // changed outside a key event)
+  processPadChanges();
+}
+
+// Play/stop pads whose state changed since previousPadStates
+void processPadChanges() {
   for (int i = 0; i < 9; i++) {
     if (padStates[i] && !previousPadStates[i]) {
       // Pad pressed
@@ -1237,6 +1349,65 @@ void updateMIDI() {
   }
 }
 
+// Dispatch a decoded message from either input (timestamp in micros)
+void handleMidiEvent(const MidiEvent& evt, uint8_t source, uint32_t timestamp) {
+  if (evt.status >= 0xF8) {
+    handleMidiRealtime(evt.status, source, timestamp);
+  } else {
+    processIncomingMIDI(evt.status, evt.data1, evt.data2);
+  }
+}
+
+void handleMidiRealtime(uint8_t rt, uint8_t source, uint32_t timestamp) {
+  switch (rt) {
+    case 0xF8:  // MIDI Clock (24 PPQN)
+      // Ticks already generated during a dropout, or from the other input, are dropped
+      if (clockTrackerTick(clockTracker, source, timestamp)) {
+        handleClockTick();
+      }
+      break;
+    case 0xFA:  // Start
+      midiTransportRunning = true;
+      midiClockCounter = 0;
+      if (!clockTrackerActive(clockTracker) || source == clockTracker.source) {
+        clockTrackerStart(clockTracker);
+      }
+      break;
+    case 0xFB:  // Continue
+      midiTransportRunning = true;
+      if (!clockTrackerActive(clockTracker) || source == clockTracker.source) {
+        clockTrackerContinue(clockTracker);
+      }
+      break;
+    case 0xFC:  // Stop
+      midiTransportRunning = false;
+      if (!clockTrackerActive(clockTracker) || source == clockTracker.source) {
+        clockTrackerStop(clockTracker);  // Don't free-wheel past a deliberate stop
+      }
+      break;
+  }
+}
+
+// One external clock tick - received, or generated by the tracker through a dropout
+void handleClockTick() {
+  midiClockReceived = true;
+  midiClockCounter++;
+  arpClockCount++;  // Count for arpeggiator sync
+
+  if (clockTracker.bpmX10 > 0) {
+    detectedBpm = (clockTracker.bpmX10 + 5) / 10;
+  }
+
+  // Visual indicator - pulse every beat (every 24 clocks)
+  if (midiClockCounter % 24 == 0) {
+    clockPulseIndicator = true;
+    lastClockPulseTime = millis();
+  }
+
+  // Advance looper on each clock tick (tick time and period for sub-tick playback)
+  looperClockTick(clockTracker.lastTickUs, clockTrackerTickUs(clockTracker));
+}
+
 void processIncomingMIDI(uint8_t status, uint8_t data1, uint8_t data2) {
   uint8_t command = status & 0xF0;
   uint8_t channel = status & 0x0F;
@@ -1288,11 +1459,7 @@ void processIncomingMIDI(uint8_t status, uint8_t data1, uint8_t data2) {
 }
 
 void forwardMIDI(uint8_t status, uint8_t data1, uint8_t data2) {
-  uint8_t usb_packet[] = {status, data1, data2};
-  usb_midi.write(usb_packet, 3);
-  Serial1.write(status);
-  Serial1.write(data1);
-  Serial1.write(data2);
+  midiOutSend(status, data1, data2);
 }
 
 //================================ ARPEGGIATOR ================================
@@ -1309,8 +1476,7 @@ const int clockDividers[7] = {
   2    // 1/64 note = 2 clocks
 };
 
-// For gate timing
-unsigned long arpNoteOnTime = 0;
+// For gate timing - true from a step's note-on until its gate-off has fired
 bool arpGateOpen = false;
 
 // Calculate interval with pattern modifiers (for internal timing)
@@ -1374,37 +1540,35 @@ int getPatternDelay() {
   }
 }
 
-// Stutter pattern state
-unsigned long stutterRepeatTime = 0;
-bool stutterPending = false;
-
 // Track last clock position we triggered on (for proper grid sync)
 int lastArpTriggerClock = -1;
 
-// Pattern delay for external clock swing/humanize
-unsigned long pendingTriggerTime = 0;
-bool hasPendingTrigger = false;
-
 // Generate internal MIDI clock and send out when no external clock
 void updateInternalClock() {
   unsigned long currentTime = millis();
 
-  // Only generate internal clock if no external clock present
-  bool clockPresent = (currentTime - lastClockTime) < 500;
-  if (clockPresent) {
-    return;  // External clock active, don't generate internal
+  // Keep external clock going through short dropouts at the tracked tempo
+  if (clockTrackerService(clockTracker, micros())) {
+    handleClockTick();
   }
 
-  // Calculate interval between clock pulses (24 PPQN)
-  // At BPM, quarter note = 60000/BPM ms, so clock pulse = 60000/(BPM*24) ms
-  unsigned long clockInterval = 60000UL / (settings.internalBpm * 24);
-
-  if (currentTime - lastInternalClockTime >= clockInterval) {
-    lastInternalClockTime = currentTime;
+  // Only generate internal clock if no external clock present
+  if (clockTrackerActive(clockTracker)) {
+    internalClockStop(internalClock);  // External clock active, don't generate internal
+    return;
+  }
 
-    // Send MIDI clock out
-    Serial1.write(0xF8);
+  if (!internalClock.running) {
+    internalClockStart(internalClock, settings.internalBpm);
+    internalClockCounter = 0;
+  }
+  internalClock.bpm = settings.internalBpm;  // Tempo edits apply from the next tick
 
+  // The alarm has already sent the clock out - catch up the counters and looper
+  uint32_t lastTickUs;
+  uint16_t ticks = internalClockTakeTicks(internalClock, lastTickUs);
+  uint32_t tickUs = internalClockTickUs(internalClock);
+  while (ticks--) {
     // Increment counter for internal sync
     internalClockCounter++;
     midiClockCounter = internalClockCounter;  // Sync with arp counter
@@ -1415,8 +1579,9 @@ void updateInternalClock() {
       lastClockPulseTime = currentTime;
     }
 
-    // Advance looper on each internal clock tick
-    looperClockTick();
+    // Advance looper on each internal clock tick (ticks caught up late are
+    // spaced back from the last one)
+    looperClockTick(lastTickUs - ticks * tickUs, tickUs);
   }
 }
 
@@ -1440,50 +1605,18 @@ void updateArpeggiator() {
 
   unsigned long currentTime = millis();
 
-  // Check if external clock is active (received within last 500ms)
-  bool clockPresent = (currentTime - lastClockTime) < 500;
-  externalClockActive = clockPresent && settings.midiClockSync;
-
-  // Handle gate off (note release before next trigger)
-  if (arpGateOpen && arpNotePlaying) {
-    int baseInterval = externalClockActive ? 80 : arpTimings[state.arpRate];
-    int gateTime = max(15, baseInterval * settings.arpGate / 100);
-
-    if (currentTime - arpNoteOnTime >= gateTime) {
-      if (state.arpMode == 6) {
-        // Chord mode - stop all notes
-        if (settings.polyMode) {
-          // Stop all held pads
-          for (int p = 0; p < 9; p++) {
-            if (padStates[p]) stopChord(p);
-          }
-        } else {
-          stopChord(state.activePad);
-        }
-      } else {
-        // Use lastArpPad which tracks correct pad for poly mode
-        stopArpNote(lastArpPad, lastArpNoteIndex);
-      }
-      arpGateOpen = false;
-      arpNotePlaying = false;
-    }
-  }
+  // External clock is active while the tracker is locked (including free-wheel)
+  externalClockActive = clockTrackerActive(clockTracker) && settings.midiClockSync;
 
-  bool shouldTrigger = false;
-
-  // Check for pending delayed trigger (for swing/humanize with external clock)
-  if (hasPendingTrigger && currentTime >= pendingTriggerTime) {
-    hasPendingTrigger = false;
-    shouldTrigger = true;
+  // Gate-offs, swing/humanize delays and stutter repeats are on the scheduler;
+  // don't decide a new step while a delayed one hasn't played yet
+  if (schedulerPending(scheduler, SCHED_OWNER_ARP_STEP)) {
+    return;
   }
 
-  // Check for stutter repeat (quick second hit)
-  if (stutterPending && currentTime >= stutterRepeatTime) {
-    stutterPending = false;
-    shouldTrigger = true;
-  }
+  uint32_t nowUs = micros();
 
-  if (externalClockActive && !hasPendingTrigger && !stutterPending) {
+  if (externalClockActive) {
     // QUANTIZED clock sync: trigger on clock grid positions
     // Use global midiClockCounter to stay locked to transport
     int divider = clockDividers[state.arpRate];
@@ -1507,22 +1640,19 @@ void updateArpeggiator() {
         if (patternDelay == -1) {
           // Skip this trigger (dotted pattern)
           state.arpStepInPattern++;  // Still count the step
-        } else if (patternDelay > 0) {
-          // Schedule delayed trigger
-          pendingTriggerTime = currentTime + patternDelay;
-          hasPendingTrigger = true;
         } else {
-          shouldTrigger = true;
-          // Schedule stutter repeat if stutter pattern
-          if (settings.arpPattern == 5 && (state.arpStepInPattern % 2 == 0)) {
+          // Stutter checks the step before arpTrigger advances it
+          bool stutter = (patternDelay == 0 && settings.arpPattern == 5 && (state.arpStepInPattern % 2 == 0));
+          arpTrigger(nowUs + patternDelay * 1000UL);
+          if (stutter) {
+            // Quick repeat
             int baseTime = 250 * 120 / max(1, detectedBpm);
-            stutterRepeatTime = currentTime + baseTime / 4;  // Quick repeat
-            stutterPending = true;
+            arpTrigger(nowUs + baseTime / 4 * 1000UL);
           }
         }
       }
     }
-  } else if (!externalClockActive && !hasPendingTrigger && !stutterPending) {
+  } else {
     // Internal timing - calculate based on internal BPM
     // arpTimings are for 120 BPM, scale to current internal BPM
     int baseInterval = arpTimings[state.arpRate] * 120 / settings.internalBpm;
@@ -1530,60 +1660,161 @@ void updateArpeggiator() {
 
     if (currentTime - state.lastArpTime >= interval) {
       state.lastArpTime = currentTime;
-      shouldTrigger = true;
+      arpTrigger(nowUs);
     }
   }
+}
 
-  if (shouldTrigger) {
-    // Stop previous note(s) if gate still open
-    if (arpGateOpen) {
-      if (state.arpMode == 6) {
-        // Chord mode - stop all notes
-        if (settings.polyMode) {
-          for (int p = 0; p < 9; p++) {
-            if (padStates[p]) stopChord(p);
-          }
-        } else if (lastArpPad >= 0) {
-          stopChord(lastArpPad);
-        }
-      } else {
-        stopArpNote(lastArpPad, lastArpNoteIndex);
-      }
-      arpNotePlaying = false;
+// Gate length of one arp step in microseconds
+uint32_t arpGateUs() {
+  int baseInterval = arpTimings[state.arpRate];
+  if (externalClockActive) {
+    // One step at the tracked tempo (80ms until the period is known)
+    uint32_t tickUs = clockTrackerTickUs(clockTracker);
+    baseInterval = (tickUs > 0) ? tickUs * clockDividers[state.arpRate] / 1000 : 80;
+  }
+  int gateTime = max(15, baseInterval * settings.arpGate / 100);
+  return gateTime * 1000UL;
+}
+
+// Play the next arp step at atUs (now, or later for swing/humanize/stutter).
+// Single notes are worked out now and handed to the scheduler as a note-on
+// and gate-off; chord steps start pad voices (voiceStart/voiceStopSlot), and
+// the voice table is only touched from loop(), so they run from there
+void arpTrigger(uint32_t atUs) {
+  if (state.arpMode == 6) {
+    if ((int32_t)(atUs - micros()) > 0) {
+      schedulerCallback(scheduler, atUs, SCHED_OWNER_ARP_STEP, arpChordStepCallback);
+    } else {
+      arpChordStep();
     }
+    return;
+  }
+
+  // The previous note's gate closes no later than this one starts
+  schedulerPull(scheduler, SCHED_OWNER_ARP_GATE, atUs);
+
+  advanceArpIndex(state.activePad);
+  state.arpStepInPattern++;
+
+  // In poly mode, use the current note from the combined pool
+  int pad = state.activePad;
+  int noteIndex = state.arpNoteIndex;
+  if (settings.polyMode && polyArpNoteCount > 0) {
+    pad = polyArpPads[polyArpCurrentPos];
+    noteIndex = polyArpNoteIndices[polyArpCurrentPos];
+  }
+
+  int velocity, channel;
+  int note = arpNoteFor(pad, noteIndex, velocity, channel);
+  if (note < 0) return;
 
-    // Advance to next note (unless Chord mode)
-    if (state.arpMode != 6) {
-      advanceArpIndex(state.activePad);
+  bool now = (int32_t)(atUs - micros()) <= 0;
+  if (now) {
+    // Arp glide: note-by-note like a mono synth (delayed notes glide when they fire)
+    startGlideForArpNote(note, channel);
+  }
+  schedulerMidi(scheduler, atUs, SCHED_NOTE_ON, SCHED_OWNER_ARP_STEP, 0x90 | channel, note, velocity, pad);
+  schedulerMidi(scheduler, atUs + arpGateUs(), SCHED_NOTE_OFF, SCHED_OWNER_ARP_GATE, 0x80 | channel, note, 0, pad);
+
+  // Track what's playing so we can stop it later (store actual MIDI note!)
+  lastArpPad = pad;
+  lastArpNoteIndex = noteIndex;
+  lastArpNoteMidi = note;
+  lastArpNoteChannel = channel;
+  arpNotePlaying = true;
+  arpGateOpen = true;
+}
+
+// Chord mode step - play ALL notes at once (like strumming)
+void arpChordStep() {
+  // Stop previous chord if gate still open
+  schedulerCancel(scheduler, SCHED_OWNER_ARP_GATE);
+  if (arpGateOpen) {
+    arpChordGateOff(arpStepId);
+  }
+
+  state.arpStepInPattern++;
+  if (settings.polyMode) {
+    // Play all held pads
+    for (int p = 0; p < 9; p++) {
+      if (padStates[p]) playChord(p);
     }
-    state.arpStepInPattern++;
+    lastArpPad = -1;  // Multiple pads
+  } else {
+    playChord(state.activePad);
+    lastArpPad = state.activePad;
+  }
+  arpNotePlaying = true;         // Mark as playing for gate logic
+  arpGateOpen = true;
 
-    // Play note(s)
-    if (state.arpMode == 6) {
-      // Chord mode - play ALL notes at once (like strumming)
-      if (settings.polyMode) {
-        // Play all held pads
-        for (int p = 0; p < 9; p++) {
-          if (padStates[p]) playChord(p);
+  arpStepId++;
+  schedulerCallback(scheduler, micros() + arpGateUs(), SCHED_OWNER_ARP_GATE, arpChordGateOff, arpStepId);
+}
+
+void arpChordStepCallback(uint8_t arg) {
+  arpChordStep();
+}
+
+// Chord mode gate-off (ignored if it belongs to an older step)
+void arpChordGateOff(uint8_t stepId) {
+  if (stepId != arpStepId || !arpGateOpen) return;
+  if (settings.polyMode) {
+    // Stop all held pads
+    for (int p = 0; p < 9; p++) {
+      if (padStates[p]) stopChord(p);
+    }
+  } else if (lastArpPad >= 0) {
+    stopChord(lastArpPad);
+  }
+  arpGateOpen = false;
+  arpNotePlaying = false;
+}
+
+// Catch up on events the scheduler has fired since the last pass: run
+// callbacks, and do the bookkeeping sendNoteOn/sendNoteOff would have done
+void updateScheduler() {
+  SchedEvent evt;
+  while (schedulerPopFired(scheduler, evt)) {
+    // Anything recorded here goes where the scheduler played it, not where
+    // loop() got round to it
+    looper.inputTimed = true;
+    looper.inputTimeUs = evt.due;
+    switch (evt.type) {
+      case SCHED_CALLBACK:
+        evt.callback(evt.data1);
+        break;
+      case SCHED_NOTE_ON:
+        if (evt.owner == SCHED_OWNER_ARP_STEP) {
+          voiceTrack(voices, VOICE_OWNER_ARP, evt.data1, evt.status & 0x0F);
+          startGlideForArpNote(evt.data1, evt.status & 0x0F);  // No-op if it already glided
         }
-        lastArpPad = -1;  // Multiple pads
-      } else {
-        playChord(state.activePad);
-        lastArpPad = state.activePad;
-      }
-      arpNotePlaying = true;         // Mark as playing for gate logic
-    } else {
-      // In poly mode, use the current note from the combined pool
-      if (settings.polyMode && polyArpNoteCount > 0) {
-        int polyPad = polyArpPads[polyArpCurrentPos];
-        int polyNote = polyArpNoteIndices[polyArpCurrentPos];
-        playArpNote(polyPad, polyNote);
-      } else {
-        playArpNote(state.activePad, state.arpNoteIndex);
-      }
+        if ((looper.recording || looper.overdubbing) && !looperIsSchedOwner(evt.owner)) {
+          looperRecordNoteOn(evt.data1, evt.data2, evt.status & 0x0F, (int8_t)evt.tag);
+        }
+        break;
+      case SCHED_NOTE_OFF:
+        if (evt.owner == SCHED_OWNER_ARP_GATE) {
+          voiceForget(voices, VOICE_OWNER_ARP, evt.data1, evt.status & 0x0F);
+        }
+        if (evt.owner == SCHED_OWNER_ARP_GATE &&
+            evt.data1 == lastArpNoteMidi && (evt.status & 0x0F) == lastArpNoteChannel) {
+          arpGateOpen = false;
+          arpNotePlaying = false;
+        }
+        if ((looper.recording || looper.overdubbing) && !looperIsSchedOwner(evt.owner)) {
+          looperRecordNoteOff(evt.data1, evt.data2, evt.status & 0x0F, (int8_t)evt.tag);
+        }
+        break;
+      case SCHED_CC:
+        if ((looper.recording || looper.overdubbing) && !looperIsSchedOwner(evt.owner)) {
+          looperRecordControl(evt.status, evt.data1, evt.data2);
+        }
+        break;
+      default:
+        break;
     }
-    arpNoteOnTime = currentTime;
-    arpGateOpen = true;
+    looper.inputTimed = false;
   }
 }
 
@@ -1595,18 +1826,14 @@ void buildPolyArpPool() {
   for (int p = 0; p < 9; p++) {
     if (!padStates[p]) continue;  // Skip pads that aren't held
 
-    ChordV2& chord = pads[p].chord;
-    int notesFromPad = 0;
+    const CompiledChord& chord = padChord(p);
 
-    for (int n = 0; n < 8; n++) {
-      if (chord.isActive[n] && notesFromPad < settings.maxNotesPerChord) {
-        polyArpPads[polyArpNoteCount] = p;
-        polyArpNoteIndices[polyArpNoteCount] = n;
-        polyArpNoteCount++;
-        notesFromPad++;
+    for (int k = 0; k < chord.count; k++) {
+      polyArpPads[polyArpNoteCount] = p;
+      polyArpNoteIndices[polyArpNoteCount] = chord.slot[k];
+      polyArpNoteCount++;
 
-        if (polyArpNoteCount >= 72) break;  // Safety limit
-      }
+      if (polyArpNoteCount >= 72) break;  // Safety limit
     }
     if (polyArpNoteCount >= 72) break;
   }
@@ -1626,28 +1853,18 @@ void advanceArpIndex(int pad) {
     return;
   }
 
-  ChordV2& chord = pads[pad].chord;
-
-  // Count active notes (limited by maxNotesPerChord)
-  int activeCount = 0;
-  int activeIndices[8];
-  for (int i = 0; i < 8; i++) {
-    if (chord.isActive[i]) {
-      if (activeCount < settings.maxNotesPerChord) {
-        activeIndices[activeCount++] = i;
-      }
-    }
-  }
+  // Active notes (limited by maxNotesPerChord)
+  const CompiledChord& chord = padChord(pad);
+  int activeCount = chord.count;
+  const uint8_t* activeIndices = chord.slot;
 
   if (activeCount == 0) return;
 
   // Find current position in active notes
   int currentPos = 0;
-  for (int i = 0; i < activeCount; i++) {
-    if (activeIndices[i] == state.arpNoteIndex) {
-      currentPos = i;
-      break;
-    }
+  if (state.arpNoteIndex >= 0 && state.arpNoteIndex < 8) {
+    int k = chord.position[state.arpNoteIndex];
+    if (k >= 0 && k < activeCount) currentPos = k;
   }
 
   int prevPos = currentPos;
@@ -1800,13 +2017,16 @@ void advancePolyArpIndex() {
   }
 }
 
-void playArpNote(int pad, int noteIndex) {
-  if (pad < 0 || pad >= 9) return;
-  if (!pads[pad].chord.isActive[noteIndex]) return;
+// Work out an arp note (octave range, velocity variation and accent applied).
+// Returns the MIDI note, or -1 if that chord note is inactive.
+int arpNoteFor(int pad, int noteIndex, int& velocity, int& outputChannel) {
+  if (pad < 0 || pad >= 9) return -1;
+  if (noteIndex < 0 || noteIndex >= 8) return -1;
 
-  ChordV2& chord = pads[pad].chord;
-  int note = settings.rootNote + chord.rootOffset + chord.intervals[noteIndex]
-             + (chord.octaveModifiers[noteIndex] * 12) + (state.currentOctave * 12);
+  const CompiledChord& chord = padChord(pad);
+  int k = chord.position[noteIndex];
+  if (k < 0) return -1;
+  int note = chord.note[k];
 
   // Apply octave shift
   int octaveShift = 0;
@@ -1851,7 +2071,7 @@ void playArpNote(int pad, int noteIndex) {
   note = constrain(note, 0, 127);
 
   // Calculate velocity with variation
-  int baseVelocity = settings.velocityScaling * (pads[pad].velocity + chord.velocityModifiers[noteIndex]);
+  int baseVelocity = settings.velocityScaling * chord.velocity[k];
 
   // Add velocity variation if enabled
   if (settings.arpVelocityVar > 0) {
@@ -1864,43 +2084,23 @@ void playArpNote(int pad, int noteIndex) {
     baseVelocity += 10;  // Slight accent
   }
 
-  int velocity = constrain(baseVelocity, 1, 127);
-
-  int channel = chord.channel[noteIndex];
-  int outputChannel = getOutputChannel(channel);
-
-  // Arp glide: note-by-note like a mono synth
-  startGlideForArpNote(note, outputChannel);
-
-  sendNoteOn(note, velocity, outputChannel);
-
-  // Track what's playing so we can stop it later (store actual MIDI note!)
-  lastArpPad = pad;
-  lastArpNoteIndex = noteIndex;
-  lastArpNoteMidi = note;  // Store the actual note with octave shift applied
-  lastArpNoteChannel = outputChannel;
-  arpNotePlaying = true;
-}
-
-void stopArpNote(int pad, int noteIndex) {
-  // Use the stored MIDI note - this includes octave shift that was applied during playback
-  if (lastArpNoteMidi >= 0) {
-    sendNoteOff(lastArpNoteMidi, 0, lastArpNoteChannel);
-  }
+  velocity = constrain(baseVelocity, 1, 127);
+  outputChannel = chord.channel[k];
+  return note;
 }
 
 // Stop whatever arp note is currently playing
 void stopCurrentArpNote() {
+  // Drop steps that haven't played, end pending gates now
+  schedulerCancel(scheduler, SCHED_OWNER_ARP_STEP);
+  schedulerPull(scheduler, SCHED_OWNER_ARP_GATE, micros());
   if (arpNotePlaying && lastArpNoteMidi >= 0) {
-    sendNoteOff(lastArpNoteMidi, 0, lastArpNoteChannel);
+    sendNoteOff(lastArpNoteMidi, 0, lastArpNoteChannel, lastArpPad);
     arpNotePlaying = false;
     lastArpPad = -1;
     lastArpNoteIndex = -1;
     lastArpNoteMidi = -1;
   }
-  // Clear any pending triggers
-  hasPendingTrigger = false;
-  stutterPending = false;
   arpGateOpen = false;
 }
 
@@ -2048,10 +2248,7 @@ void checkScreensaver() {
   if (!screensaver.active) {
     // Check if should activate
     if (now - screensaver.lastInputTime > timeout) {
-      screensaver.active = true;
-      if (!screensaver.initialized) {
-        initScreensaver(screensaver);
-      }
+      screensaver.active = true;  // Core1 starts the animation
     }
   }
   // Deactivation happens in input handlers (checkKeys)
@@ -2079,91 +2276,44 @@ void playChord(int pad) {
     return;  // Don't play new notes!
   }
 
-  ChordV2& chord = pads[pad].chord;
-
-  // Collect new chord notes first (for CC84 polyphonic glide)
-  int newNotes[8];
-  int newNoteChannels[8];
-  int newNoteCount = 0;
-
-  for (int j = 0; j < 8 && newNoteCount < settings.maxNotesPerChord; j++) {
-    if (chord.isActive[j]) {
-      int note = settings.rootNote + chord.rootOffset + chord.intervals[j]
-                 + (chord.octaveModifiers[j] * 12) + (state.currentOctave * 12);
-      newNotes[newNoteCount] = constrain(note, 0, 127);
-      newNoteChannels[newNoteCount] = getOutputChannel(chord.channel[j]);
-      newNoteCount++;
-    }
-  }
+  const CompiledChord& chord = padChord(pad);
 
   // Play notes with CC84 glide (if in CC mode)
   bool useCC84 = (state.specialMode == SPECIAL_MODE_GLIDE &&
                   settings.glideType == 0 &&
                   glideState.lastChordNoteCount > 0);
 
-  int notesPlayed = 0;
-  for (int j = 0; j < 8; j++) {
-    if (chord.isActive[j]) {
-      if (notesPlayed < settings.maxNotesPerChord) {
-        // Send CC84 before note-on for polyphonic glide
-        if (useCC84 && notesPlayed < glideState.lastChordNoteCount) {
-          int fromNote = glideState.lastChordNotes[notesPlayed];
-          if (fromNote >= 0) {
-            int channel = getOutputChannel(chord.channel[j]);
-            sendPortamentoControl(fromNote, channel);
-          }
-        }
-        playNote(pad, j);
-        notesPlayed++;
+  for (int k = 0; k < chord.count; k++) {
+    // Send CC84 before note-on for polyphonic glide
+    if (useCC84 && k < glideState.lastChordNoteCount) {
+      int fromNote = glideState.lastChordNotes[k];
+      if (fromNote >= 0) {
+        sendPortamentoControl(fromNote, chord.channel[k]);
       }
     }
+    playNote(pad, chord.slot[k]);
   }
 
   // Store new chord notes for next glide
   for (int i = 0; i < 8; i++) {
-    glideState.lastChordNotes[i] = (i < newNoteCount) ? newNotes[i] : -1;
+    glideState.lastChordNotes[i] = (i < chord.count) ? chord.note[i] : -1;
   }
-  glideState.lastChordNoteCount = newNoteCount;
+  glideState.lastChordNoteCount = chord.count;
 }
 
 void playNote(int pad, int noteIndex) {
-  ChordV2& chord = pads[pad].chord;
-
-  int note = settings.rootNote + chord.rootOffset + chord.intervals[noteIndex]
-             + (chord.octaveModifiers[noteIndex] * 12) + (state.currentOctave * 12);
-
-  note = constrain(note, 0, 127);
+  const CompiledChord& chord = padChord(pad);
+  int k = chord.position[noteIndex];
+  if (k < 0) return;
 
   int velocity = constrain(
-    settings.velocityScaling * (pads[pad].velocity + chord.velocityModifiers[noteIndex]
+    settings.velocityScaling * (chord.velocity[k]
     + random(-pads[pad].velocityVariation, pads[pad].velocityVariation + 1)),
     1, 127
   );
 
-  int channelIndex = chord.channel[noteIndex];
-  int outputChannel = getOutputChannel(channelIndex);
-
-  // Reference counting
-  switch (channelIndex) {
-    case 0:
-      if (noteCountA[note] > 0) sendNoteOff(note, 0, outputChannel);
-      noteCountA[note]++;
-      break;
-    case 1:
-      if (noteCountB[note] > 0) sendNoteOff(note, 0, outputChannel);
-      noteCountB[note]++;
-      break;
-    case 2:
-      if (noteCountC[note] > 0) sendNoteOff(note, 0, outputChannel);
-      noteCountC[note]++;
-      break;
-    case 3:
-      if (noteCountD[note] > 0) sendNoteOff(note, 0, outputChannel);
-      noteCountD[note]++;
-      break;
-  }
-
-  sendNoteOn(note, velocity, outputChannel);
+  // Retriggers if another pad already holds this note
+  voiceStart(voices, pad, noteIndex, chord.note[k], velocity, chord.channel[k]);
 }
 
 void stopChord(int pad) {
@@ -2177,119 +2327,44 @@ void stopChord(int pad) {
 }
 
 void stopNote(int pad, int noteIndex) {
-  ChordV2& chord = pads[pad].chord;
-
-  int note = settings.rootNote + chord.rootOffset + chord.intervals[noteIndex]
-             + (chord.octaveModifiers[noteIndex] * 12) + (state.currentOctave * 12);
-
-  note = constrain(note, 0, 127);
-
-  int channelIndex = chord.channel[noteIndex];
-  int outputChannel = getOutputChannel(channelIndex);
-
-  // Reference counting
-  switch (channelIndex) {
-    case 0:
-      if (noteCountA[note] > 0) {
-        noteCountA[note]--;
-        if (noteCountA[note] == 0) sendNoteOff(note, 0, outputChannel);
-      }
-      break;
-    case 1:
-      if (noteCountB[note] > 0) {
-        noteCountB[note]--;
-        if (noteCountB[note] == 0) sendNoteOff(note, 0, outputChannel);
-      }
-      break;
-    case 2:
-      if (noteCountC[note] > 0) {
-        noteCountC[note]--;
-        if (noteCountC[note] == 0) sendNoteOff(note, 0, outputChannel);
-      }
-      break;
-    case 3:
-      if (noteCountD[note] > 0) {
-        noteCountD[note]--;
-        if (noteCountD[note] == 0) sendNoteOff(note, 0, outputChannel);
-      }
-      break;
-  }
+  // Releases the note that was actually sent, whatever root/octave are now
+  voiceStopSlot(voices, pad, noteIndex);
 }
 
-int getOutputChannel(int index) {
-  switch (index) {
-    case 0: return settings.midiOutputAChannel;
-    case 1: return settings.midiOutputBChannel;
-    case 2: return settings.midiOutputCChannel;
-    case 3: return settings.midiOutputDChannel;
-    default: return settings.midiOutputAChannel;
-  }
+// What a pad plays right now (rebuilt only when its inputs change)
+const CompiledChord& padChord(int pad) {
+  return chordCacheGet(chordCache, pad, pads, settings, state);
 }
 
-void sendNoteOn(int note, int velocity, int channel) {
+// pad: which pad the note belongs to (-1 if none) - kept with looper recordings
+void sendNoteOn(int note, int velocity, int channel, int pad) {
   if (channel < 0 || channel > 15) return;
-  uint8_t status = 0x90 | channel;
-  uint8_t usb_packet[] = {status, (uint8_t)note, (uint8_t)velocity};
-  usb_midi.write(usb_packet, 3);
-  Serial1.write(status);
-  Serial1.write(note);
-  Serial1.write(velocity);
+  midiOutSend(0x90 | channel, note, velocity);
 
   // Record to looper if recording/overdubbing
   if (looper.recording || looper.overdubbing) {
-    looperRecordNoteOn(note, velocity);
+    looperRecordNoteOn(note, velocity, channel, pad);
   }
 }
 
-void sendNoteOff(int note, int velocity, int channel) {
+void sendNoteOff(int note, int velocity, int channel, int pad) {
   if (channel < 0 || channel > 15) return;
-  uint8_t status = 0x80 | channel;
-  uint8_t usb_packet[] = {status, (uint8_t)note, (uint8_t)velocity};
-  usb_midi.write(usb_packet, 3);
-  Serial1.write(status);
-  Serial1.write(note);
-  Serial1.write(velocity);
+  midiOutSend(0x80 | channel, note, velocity);
 
   // Record to looper if recording/overdubbing
   if (looper.recording || looper.overdubbing) {
-    looperRecordNoteOff(note, velocity);
+    looperRecordNoteOff(note, velocity, channel, pad);
   }
 }
 
-//================================ LOOPER HELPERS ================================
-
-// Get the output channel for looper playback
-int getLooperOutputChannel() {
-  return settings.midiOutputAChannel;
-}
-
-// Find which pad corresponds to a given MIDI note (for LED feedback)
-int looperFindPadForNoteImpl(uint8_t note) {
-  for (int i = 0; i < 9; i++) {
-    ChordV2& chord = pads[i].chord;
-    for (int j = 0; j < 8; j++) {
-      if (chord.isActive[j]) {
-        int padNote = settings.rootNote + chord.rootOffset + chord.intervals[j];
-        // Check with different octave offsets (-3 to +3)
-        for (int oct = -3; oct <= 3; oct++) {
-          if (padNote + (oct * 12) == (int)note) {
-            return i;
-          }
-        }
-      }
-    }
-  }
-  return -1;  // Not found
-}
-
 void sendControlChange(int cc, int value, int channel) {
   if (channel < 0 || channel > 15) return;
-  uint8_t status = 0xB0 | channel;  // CC status byte
-  uint8_t usb_packet[] = {status, (uint8_t)cc, (uint8_t)value};
-  usb_midi.write(usb_packet, 3);
-  Serial1.write(status);
-  Serial1.write(cc);
-  Serial1.write(value);
+  midiOutSend(0xB0 | channel, cc, value);  // CC status byte
+
+  // Record to looper if recording/overdubbing (thinned there)
+  if (looper.recording || looper.overdubbing) {
+    looperRecordControl(0xB0 | channel, cc, value);
+  }
 }
 
 //================================ CC PORTAMENTO ================================
@@ -2335,12 +2410,12 @@ void sendPitchBend(int value, int channel) {
   value = constrain(value, 0, 16383);
   uint8_t lsb = value & 0x7F;         // Lower 7 bits
   uint8_t msb = (value >> 7) & 0x7F;  // Upper 7 bits
-  uint8_t status = 0xE0 | channel;    // Pitch bend status
-  uint8_t usb_packet[] = {status, lsb, msb};
-  usb_midi.write(usb_packet, 3);
-  Serial1.write(status);
-  Serial1.write(lsb);
-  Serial1.write(msb);
+  midiOutSend(0xE0 | channel, lsb, msb);  // Pitch bend status
+
+  // Record to looper if recording/overdubbing (thinned there)
+  if (looper.recording || looper.overdubbing) {
+    looperRecordControl(0xE0 | channel, lsb, msb);
+  }
 }
 
 // Set pitch bend range via RPN (in semitones)
@@ -2355,12 +2430,24 @@ void setPitchBendRange(int semitones, int channel) {
   sendControlChange(100, 127, channel);
 }
 
-// Send pitch bend to all output channels
+// Send pitch bend to all output channels (once per distinct channel - outputs
+// usually share one channel, and duplicates would just pad the USB batch)
 void sendPitchBendToAllChannels(int value) {
-  sendPitchBend(value, settings.midiOutputAChannel);
-  sendPitchBend(value, settings.midiOutputBChannel);
-  sendPitchBend(value, settings.midiOutputCChannel);
-  sendPitchBend(value, settings.midiOutputDChannel);
+  int channels[] = {
+    settings.midiOutputAChannel,
+    settings.midiOutputBChannel,
+    settings.midiOutputCChannel,
+    settings.midiOutputDChannel
+  };
+  for (int i = 0; i < 4; i++) {
+    bool alreadySent = false;
+    for (int j = 0; j < i; j++) {
+      if (channels[j] == channels[i]) alreadySent = true;
+    }
+    if (!alreadySent) {
+      sendPitchBend(value, channels[i]);
+    }
+  }
 }
 
 // Initialize glide mode - setup CC portamento or pitch bend depending on type
@@ -2403,6 +2490,7 @@ void exitGlideMode() {
     sendPitchBendToAllChannels(GLIDE_PITCH_BEND_CENTER);
   }
   // Stop any pending overlap chord
+  schedulerCancel(scheduler, SCHED_OWNER_GLIDE);
   if (glideState.oldPadToStop >= 0) {
     stopChord(glideState.oldPadToStop);
   }
@@ -2421,8 +2509,7 @@ void exitGlideMode() {
 // Get root note for a pad (lowest note of chord with octave)
 int getPadRootNote(int pad) {
   if (pad < 0 || pad >= 9) return -1;
-  ChordV2& chord = pads[pad].chord;
-  return settings.rootNote + chord.rootOffset + (state.currentOctave * 12);
+  return padChord(pad).rootNote;
 }
 
 // Start a glide from previous chord to new chord
@@ -2459,6 +2546,9 @@ bool startGlideForPad(int newPad) {
     }
     glideState.startTime = millis();
     glideState.active = true;
+    // Stop old chord after short delay (20ms) to ensure notes overlap for legato trigger
+    schedulerCancel(scheduler, SCHED_OWNER_GLIDE);
+    schedulerCallback(scheduler, micros() + 20000UL, SCHED_OWNER_GLIDE, glideOverlapDone);
     // CC mode plays new notes (synth handles the glide)
     glideState.lastRootNote = newRoot;
     glideState.lastPad = newPad;
@@ -2541,6 +2631,7 @@ void updateGlide() {
     if (settings.glideType == 1) {
       sendPitchBendToAllChannels(GLIDE_PITCH_BEND_CENTER);
     }
+    schedulerCancel(scheduler, SCHED_OWNER_GLIDE);
     if (glideState.oldPadToStop >= 0) {
       stopChord(glideState.oldPadToStop);
       glideState.oldPadToStop = -1;
@@ -2549,21 +2640,13 @@ void updateGlide() {
     return;
   }
 
-  unsigned long elapsed = millis() - glideState.startTime;
-
   if (settings.glideType == 0) {
-    // CC Portamento mode - synth handles glide, we just manage legato overlap
-    // Stop old chord after short delay (20ms) to ensure notes overlap for legato trigger
-    if (elapsed >= 20) {
-      if (glideState.oldPadToStop >= 0) {
-        stopChord(glideState.oldPadToStop);
-        glideState.oldPadToStop = -1;
-      }
-      glideState.active = false;
-    }
+    // CC Portamento mode - synth handles glide, the legato overlap is on the scheduler
     return;
   }
 
+  unsigned long elapsed = millis() - glideState.startTime;
+
   // Pitch Bend mode - animate the glide ourselves
   // Old chord was already stopped in startGlideForPad() before pitch bend was sent
   // Time range: 20ms (fast) to glideMaxMs (configurable, default 3000ms)
@@ -2583,33 +2666,36 @@ void updateGlide() {
   }
 }
 
+// CC Portamento mode - overlap time is up, release the old chord
+void glideOverlapDone(uint8_t arg) {
+  if (glideState.oldPadToStop >= 0) {
+    stopChord(glideState.oldPadToStop);
+    glideState.oldPadToStop = -1;
+  }
+  glideState.active = false;
+}
+
 void killAllNotes() {
+  // Scheduled note-offs go out now, everything else pending is dropped
+  schedulerCancelAll(scheduler);
+
   // Reset pitch bend first
   sendPitchBendToAllChannels(GLIDE_PITCH_BEND_CENTER);
 
-  // Stop current arp note (arp doesn't use reference counting)
+  // Stop current arp note (the scheduler sent it; its voice is only tracked with voiceTrack)
   if (lastArpNoteMidi >= 0) {
-    sendNoteOff(lastArpNoteMidi, 0, lastArpNoteChannel);
+    sendNoteOff(lastArpNoteMidi, 0, lastArpNoteChannel, lastArpPad);
     lastArpNoteMidi = -1;
     lastArpPad = -1;
     lastArpNoteIndex = -1;
     arpNotePlaying = false;
   }
   arpGateOpen = false;
-  hasPendingTrigger = false;
-  stutterPending = false;
-
-  // Stop all reference-counted notes
-  for (int i = 0; i < 128; i++) {
-    if (noteCountA[i] > 0) sendNoteOff(i, 0, settings.midiOutputAChannel);
-    noteCountA[i] = 0;
-    if (noteCountB[i] > 0) sendNoteOff(i, 0, settings.midiOutputBChannel);
-    noteCountB[i] = 0;
-    if (noteCountC[i] > 0) sendNoteOff(i, 0, settings.midiOutputCChannel);
-    noteCountC[i] = 0;
-    if (noteCountD[i] > 0) sendNoteOff(i, 0, settings.midiOutputDChannel);
-    noteCountD[i] = 0;
-  }
+
+  // Stop every other sounding note (arp voices already got their gate-off)
+  voicesForgetOwner(voices, VOICE_OWNER_ARP);
+  voicesPanic(voices);
+
   // Reset glide state so next chord/note starts fresh
   glideState.lastRootNote = -1;
   glideState.lastPad = -1;
@@ -2622,54 +2708,67 @@ void killAllNotes() {
 
 //================================ VISUALS ================================
 
-// Idle brightness levels (very dim)
-#define IDLE_DIM 0.03          // Very dim for idle pads
-#define IDLE_CONTROL_DIM 0.05  // Slightly visible for control buttons
-#define ACTIVE_BRIGHT 1.0      // Full brightness when pressed/active
-
-void updateVisuals() {
+// Idle brightness levels (very dim), 0..256
+#define IDLE_DIM LED_LEVEL(0.03)          // Very dim for idle pads
+#define IDLE_CONTROL_DIM LED_LEVEL(0.05)  // Slightly visible for control buttons
+#define ACTIVE_BRIGHT LED_LEVEL_FULL      // Full brightness when pressed/active
+#define LATCHED_DIM LED_LEVEL(0.5)        // Latched pad
+#define LOOPER_IDLE_DIM LED_LEVEL(0.3)    // Looper has content but is stopped
+
+// Animated control LEDs
+const LedEffect LED_FX_SETTINGS  = {0xFFFF00, LED_WAVE_BLINK, LED_PHASE_INC(300), LED_LEVEL(0.4), LED_LEVEL_FULL};  // Yellow hard blink
+const LedEffect LED_FX_LATCH     = {0xFF00FF, LED_WAVE_BLINK, LED_PHASE_INC(200), LED_LEVEL(0.5), LED_LEVEL_FULL};  // Magenta hard blink
+const LedEffect LED_FX_MODE_MENU = {0x00FFFF, LED_WAVE_BLINK, LED_PHASE_INC(400), LED_LEVEL(0.4), LED_LEVEL_FULL};  // Cyan hard blink when selecting
+const LedEffect LED_FX_GENERATIVE = {0x00FF80, LED_WAVE_PULSE, LED_PHASE_INC(LED_SIN_PERIOD_MS(300)), LED_LEVEL(0.3), LED_LEVEL_FULL};  // Green-cyan pulse
+const LedEffect LED_FX_GLIDE     = {0xFFAA00, LED_WAVE_PULSE, LED_PHASE_INC(LED_SIN_PERIOD_MS(400)), LED_LEVEL(0.3), LED_LEVEL_FULL};  // Gold/yellow pulse
+const LedEffect LED_FX_LOOPER_REC  = {COLOR_LOOPER_REC, LED_WAVE_PULSE, LED_PHASE_INC(LED_SIN_PERIOD_MS(66.7)), 0, LED_LEVEL_FULL};    // Fast red pulse
+const LedEffect LED_FX_LOOPER_OVER = {COLOR_LOOPER_OVER, LED_WAVE_PULSE, LED_PHASE_INC(LED_SIN_PERIOD_MS(100)), 0, LED_LEVEL_FULL};   // Orange pulse
+const LedEffect LED_FX_LOOPER_PLAY = {COLOR_LOOPER_PLAY, LED_WAVE_PULSE, LED_PHASE_INC(LED_SIN_PERIOD_MS(125)), LED_LEVEL(-0.2), LED_LEVEL_FULL};  // Green pulse, off at the bottom
+
+void updateVisuals(const UiSnapshot& ui) {
+  uint32_t now = millis();
   pixels.clear();
 
   // Shift key LED (pixel 0)
-  if (shiftState) {
+  if (ui.shiftState) {
     pixels.setPixelColor(0, COLOR_SHIFT);
   } else {
-    pixels.setPixelColor(0, dimColor(COLOR_SHIFT, IDLE_DIM));
+    pixels.setPixelColor(0, ledScale(COLOR_SHIFT, IDLE_DIM));
   }
 
   // Chord pad LEDs - map to physical button positions
   // Layout: buttons 0,1,2 (row0), 4,5,6 (row1), 8,9,10 (row2) are chord pads
   // Pixel index = button index + 1
-  bool mutationFlashActive = (millis() - lastMutationFlash < 80);  // 80ms flash
+  bool mutationFlashActive = (now - ui.lastMutationFlash < 80);  // 80ms flash
 
   for (int i = 0; i < 9; i++) {
     int btnIndex = CHORD_PAD_BUTTONS[i];
     int pixelIndex = btnIndex + 1;
     uint32_t color;
 
-    if (padStates[i] || (state.activePad == i && state.arpRate > 0)) {
+    if (ui.padStates[i] || (ui.state.activePad == i && ui.state.arpRate > 0)) {
       // Playing - check for mutation flash
-      if (state.activePad == i && mutationFlashActive && state.specialMode == SPECIAL_MODE_GENERATIVE) {
+      if (ui.state.activePad == i && mutationFlashActive && ui.state.specialMode == SPECIAL_MODE_GENERATIVE) {
         // Mutation flash - bright cyan burst
         color = 0x00FFFF;
       } else {
         // Normal playing - full brightness white
         color = COLOR_PLAYING;
       }
-    } else if (state.activePad == i && state.latchMode) {
+    } else if (ui.state.activePad == i && ui.state.latchMode) {
       // Latched note - show pad color at medium brightness
-      if (mutationFlashActive && state.specialMode == SPECIAL_MODE_GENERATIVE) {
+      if (mutationFlashActive && ui.state.specialMode == SPECIAL_MODE_GENERATIVE) {
         color = 0x00FFFF;  // Mutation flash
       } else {
-        color = dimColor(padColors[i], 0.5);
+        color = ledScale(padColors[i], LATCHED_DIM);
       }
     } else {
       // Idle - very dim
-      color = dimColor(padColors[i], IDLE_DIM);
+      color = ledScale(padColors[i], IDLE_DIM);
     }
 
     // Looper playback flash - override pad color when looper plays this pad's notes
-    if (looper.lastPlayedPad == i && (millis() - looper.lastPlayedTime < 100)) {
+    if (ui.looper.lastPlayedPad == i && (now - ui.looper.lastPlayedTime < 100)) {
       color = COLOR_PLAYING;  // Flash white
     }
 
@@ -2678,136 +2777,118 @@ void updateVisuals() {
 
   // Column 4 buttons (3, 7, 11) - special functions with distinct colors
   // Button 3 = settings toggle (YELLOW - fast blink when active)
-  if (state.inSettingsMode) {
-    float blink = ((millis() / 150) % 2) ? 1.0 : 0.4;
-    pixels.setPixelColor(4, dimColor(0xFFFF00, blink));  // Yellow hard blink
+  if (ui.state.inSettingsMode) {
+    pixels.setPixelColor(4, ledEffectColor(LED_FX_SETTINGS, now));
   } else {
-    pixels.setPixelColor(4, dimColor(0xFFFF00, IDLE_CONTROL_DIM));  // Very dim yellow
+    pixels.setPixelColor(4, ledScale(0xFFFF00, IDLE_CONTROL_DIM));  // Very dim yellow
   }
 
   // Button 7 = LATCH toggle (MAGENTA - fastest blink when active)
-  if (state.latchMode) {
-    float blink = ((millis() / 100) % 2) ? 1.0 : 0.5;
-    pixels.setPixelColor(8, dimColor(0xFF00FF, blink));  // Magenta hard blink
+  if (ui.state.latchMode) {
+    pixels.setPixelColor(8, ledEffectColor(LED_FX_LATCH, now));
   } else {
-    pixels.setPixelColor(8, dimColor(0xFF00FF, IDLE_CONTROL_DIM));  // Very dim magenta
+    pixels.setPixelColor(8, ledScale(0xFF00FF, IDLE_CONTROL_DIM));  // Very dim magenta
   }
 
   // Button 11 = special modes toggle (CYAN - shows mode status)
-  if (state.inSpecialModeMenu) {
-    float blink = ((millis() / 200) % 2) ? 1.0 : 0.4;
-    pixels.setPixelColor(12, dimColor(0x00FFFF, blink));  // Cyan hard blink when selecting
-  } else if (state.specialMode == SPECIAL_MODE_GENERATIVE) {
-    // Generative mode active - pulsing green-cyan
-    float pulse = 0.3 + 0.7 * (sin(millis() / 300.0) * 0.5 + 0.5);
-    pixels.setPixelColor(12, dimColor(0x00FF80, pulse));  // Green-cyan pulse
-  } else if (state.specialMode == SPECIAL_MODE_GLIDE) {
-    // Glide mode active - pulsing yellow/gold
-    float pulse = 0.3 + 0.7 * (sin(millis() / 400.0) * 0.5 + 0.5);
-    pixels.setPixelColor(12, dimColor(0xFFAA00, pulse));  // Gold/yellow pulse
+  if (ui.state.inSpecialModeMenu) {
+    pixels.setPixelColor(12, ledEffectColor(LED_FX_MODE_MENU, now));
+  } else if (ui.state.specialMode == SPECIAL_MODE_GENERATIVE) {
+    pixels.setPixelColor(12, ledEffectColor(LED_FX_GENERATIVE, now));
+  } else if (ui.state.specialMode == SPECIAL_MODE_GLIDE) {
+    pixels.setPixelColor(12, ledEffectColor(LED_FX_GLIDE, now));
   } else {
-    pixels.setPixelColor(12, dimColor(0x00FFFF, IDLE_CONTROL_DIM));  // Very dim cyan when normal
+    pixels.setPixelColor(12, ledScale(0x00FFFF, IDLE_CONTROL_DIM));  // Very dim cyan when normal
   }
 
   // Bottom row controls
   // Octave buttons (12, 13) -> pixels 13, 14
   // Oct- also shows looper recording status
-  bool octDownPressed = keyStates[BTN_OCT_DOWN];
-  bool octUpPressed = keyStates[BTN_OCT_UP];
+  bool octDownPressed = ui.keyStates[BTN_OCT_DOWN];
+  bool octUpPressed = ui.keyStates[BTN_OCT_UP];
   uint32_t octDownColor, octUpColor;
 
   // Looper LED feedback on Oct- button (pixel 13)
-  if (looper.recording) {
-    // Recording: fast red pulse
-    float pulse = 0.5 + 0.5 * sin(millis() * 0.015);
-    octDownColor = dimColor(COLOR_LOOPER_REC, pulse);
-  } else if (looper.overdubbing) {
-    // Overdubbing: orange pulse
-    float pulse = 0.5 + 0.5 * sin(millis() * 0.01);
-    octDownColor = dimColor(COLOR_LOOPER_OVER, pulse);
-  } else if (looper.playing) {
-    // Playing: green pulse
-    float pulse = 0.4 + 0.6 * sin(millis() * 0.008);
-    octDownColor = dimColor(COLOR_LOOPER_PLAY, pulse);
-  } else if (looper.hasContent) {
+  if (ui.looper.recording) {
+    octDownColor = ledEffectColor(LED_FX_LOOPER_REC, now);
+  } else if (ui.looper.overdubbing) {
+    octDownColor = ledEffectColor(LED_FX_LOOPER_OVER, now);
+  } else if (ui.looper.playing) {
+    octDownColor = ledEffectColor(LED_FX_LOOPER_PLAY, now);
+  } else if (ui.looper.hasContent) {
     // Has content but stopped: dim magenta
-    octDownColor = dimColor(COLOR_LOOPER_IDLE, 0.3);
+    octDownColor = ledScale(COLOR_LOOPER_IDLE, LOOPER_IDLE_DIM);
   } else {
     // Normal octave behavior
-    octDownColor = octDownPressed ? COLOR_OCTAVE : dimColor(COLOR_OCTAVE, IDLE_CONTROL_DIM);
-    if (state.currentOctave <= -3) octDownColor = dimColor(COLOR_OCTAVE, IDLE_DIM);
+    octDownColor = octDownPressed ? COLOR_OCTAVE : ledScale(COLOR_OCTAVE, IDLE_CONTROL_DIM);
+    if (ui.state.currentOctave <= -3) octDownColor = ledScale(COLOR_OCTAVE, IDLE_DIM);
   }
 
   // Oct+ normal behavior
-  octUpColor = octUpPressed ? COLOR_OCTAVE : dimColor(COLOR_OCTAVE, IDLE_CONTROL_DIM);
-  if (state.currentOctave >= 3) octUpColor = dimColor(COLOR_OCTAVE, IDLE_DIM);
+  octUpColor = octUpPressed ? COLOR_OCTAVE : ledScale(COLOR_OCTAVE, IDLE_CONTROL_DIM);
+  if (ui.state.currentOctave >= 3) octUpColor = ledScale(COLOR_OCTAVE, IDLE_DIM);
 
   pixels.setPixelColor(13, octDownColor);  // Oct-
   pixels.setPixelColor(14, octUpColor);    // Oct+
 
   // Arp buttons (14, 15) -> pixels 15, 16
-  bool arpDownPressed = keyStates[BTN_ARP_DOWN];
-  bool arpUpPressed = keyStates[BTN_ARP_UP];
+  bool arpDownPressed = ui.keyStates[BTN_ARP_DOWN];
+  bool arpUpPressed = ui.keyStates[BTN_ARP_UP];
   uint32_t arpDownColor, arpUpColor;
 
-  if (state.arpRate > 0) {
-    // Arp active - show brightness based on rate
-    float brightness = 0.2 + (state.arpRate / 6.0) * 0.8;
-    arpDownColor = arpDownPressed ? COLOR_ARP : dimColor(COLOR_ARP, brightness);
-    arpUpColor = arpUpPressed ? COLOR_ARP : dimColor(COLOR_ARP, brightness);
+  if (ui.state.arpRate > 0) {
+    // Arp active - show brightness based on rate (0.2 .. 1.0 over rates 0..6)
+    uint16_t brightness = LED_LEVEL(0.2) + (ui.state.arpRate * LED_LEVEL(0.8)) / 6;
+    arpDownColor = arpDownPressed ? COLOR_ARP : ledScale(COLOR_ARP, brightness);
+    arpUpColor = arpUpPressed ? COLOR_ARP : ledScale(COLOR_ARP, brightness);
   } else {
     // Arp off - very dim unless pressed
-    arpDownColor = arpDownPressed ? COLOR_ARP : dimColor(COLOR_ARP, IDLE_CONTROL_DIM);
-    arpUpColor = arpUpPressed ? COLOR_ARP : dimColor(COLOR_ARP, IDLE_CONTROL_DIM);
+    arpDownColor = arpDownPressed ? COLOR_ARP : ledScale(COLOR_ARP, IDLE_CONTROL_DIM);
+    arpUpColor = arpUpPressed ? COLOR_ARP : ledScale(COLOR_ARP, IDLE_CONTROL_DIM);
   }
   pixels.setPixelColor(15, arpDownColor);  // Arp-
   pixels.setPixelColor(16, arpUpColor);    // Arp+
 
-  pixels.show();
-}
-
-uint32_t dimColor(uint32_t color, float factor) {
-  uint8_t red = (color >> 16) & 0xFF;
-  uint8_t green = (color >> 8) & 0xFF;
-  uint8_t blue = color & 0xFF;
-
-  red = (uint8_t)(red * factor);
-  green = (uint8_t)(green * factor);
-  blue = (uint8_t)(blue * factor);
-
-  return (red << 16) | (green << 8) | blue;
+  ledsShow(ledOutput, pixels);
 }
 
 //================================ DISPLAY ================================
 
-void updateDisplay() {
+void updateDisplay(const UiSnapshot& ui) {
   // Check for screensaver first
-  if (screensaver.active) {
-    updateScreensaver(screensaver);
-    drawScreensaver(display, screensaver);
+  if (ui.screensaverActive) {
+    if (!screensaverAnim.initialized) {
+      initScreensaver(screensaverAnim);
+    }
+    updateScreensaver(screensaverAnim);
+    drawScreensaver(display, screensaverAnim);
+    displayFlush(display, displayFlushState, OLED_ADDR);
     return;  // Skip normal display update
   }
 
   display.clearDisplay();
 
-  if (state.inSettingsMode) {
-    drawSettingsScreen();
-  } else if (state.inArpSettings) {
-    drawArpSettingsScreen();
-  } else if (state.inMaxNotesMenu) {
-    drawMaxNotesScreen();
-  } else if (state.inSpecialModeMenu) {
-    drawSpecialModeScreen();
-  } else if (looper.hasContent || looper.recording || looper.overdubbing) {
-    drawLooperScreen();  // Show looper when active
+  if (ui.state.inSettingsMode) {
+    drawSettingsScreen(ui);
+  } else if (ui.state.inArpSettings) {
+    drawArpSettingsScreen(ui);
+  } else if (ui.state.inMaxNotesMenu) {
+    drawMaxNotesScreen(ui);
+  } else if (ui.state.inLooperMenu) {
+    drawLooperMenuScreen(ui);
+  } else if (ui.state.inSpecialModeMenu) {
+    drawSpecialModeScreen(ui);
+  } else if (ui.looper.hasContent || ui.looper.recording || ui.looper.overdubbing) {
+    drawLooperScreen(ui.looper, ui.looperView);  // Show looper when active
   } else {
-    drawMainScreen();
+    drawMainScreen(ui);
   }
 
-  display.display();
+  // Only the bytes that differ from what the panel already shows go out
+  displayFlush(display, displayFlushState, OLED_ADDR);
 }
 
-void drawArpSettingsScreen() {
+void drawArpSettingsScreen(const UiSnapshot& ui) {
   // Marquee style single-item menu (same as settings)
   // Items: Pattern, Gate, Swing, Humanize, Velocity, Octave, Mode, Chords
 
@@ -2815,39 +2896,39 @@ void drawArpSettingsScreen() {
   char valueStr[16];
 
   // Get current item's value
-  switch (state.arpSettingsPage) {
+  switch (ui.state.arpSettingsPage) {
     case 0: // Pattern
-      snprintf(valueStr, sizeof(valueStr), "%s", arpPatternNames[settings.arpPattern]);
+      snprintf(valueStr, sizeof(valueStr), "%s", arpPatternNames[ui.settings.arpPattern]);
       break;
     case 1: // Gate
-      snprintf(valueStr, sizeof(valueStr), "%d%%", settings.arpGate);
+      snprintf(valueStr, sizeof(valueStr), "%d%%", ui.settings.arpGate);
       break;
     case 2: // Swing
-      snprintf(valueStr, sizeof(valueStr), "%d%%", settings.arpSwing);
+      snprintf(valueStr, sizeof(valueStr), "%d%%", ui.settings.arpSwing);
       break;
     case 3: // Humanize
-      snprintf(valueStr, sizeof(valueStr), "%dms", settings.arpHumanize);
+      snprintf(valueStr, sizeof(valueStr), "%dms", ui.settings.arpHumanize);
       break;
     case 4: // Velocity Var
-      snprintf(valueStr, sizeof(valueStr), "+/-%d", settings.arpVelocityVar);
+      snprintf(valueStr, sizeof(valueStr), "+/-%d", ui.settings.arpVelocityVar);
       break;
     case 5: // Octave
-      snprintf(valueStr, sizeof(valueStr), "%s", arpOctaveNames[settings.arpOctaveRange]);
+      snprintf(valueStr, sizeof(valueStr), "%s", arpOctaveNames[ui.settings.arpOctaveRange]);
       break;
     case 6: // Mode
-      snprintf(valueStr, sizeof(valueStr), "%s", arpModeNames[state.arpMode]);
+      snprintf(valueStr, sizeof(valueStr), "%s", arpModeNames[ui.state.arpMode]);
       break;
     case 7: // Play Chords
-      snprintf(valueStr, sizeof(valueStr), "%s", settings.arpPlayChords ? "ON" : "OFF");
+      snprintf(valueStr, sizeof(valueStr), "%s", ui.settings.arpPlayChords ? "ON" : "OFF");
       break;
   }
 
   // Label at top (small)
   display.setTextSize(1);
-  int labelLen = strlen(labels[state.arpSettingsPage]);
+  int labelLen = strlen(labels[ui.state.arpSettingsPage]);
   int labelX = 64 - (labelLen * 3);
   display.setCursor(labelX, 8);
-  display.print(labels[state.arpSettingsPage]);
+  display.print(labels[ui.state.arpSettingsPage]);
 
   // Value in center (size 2 to fit longer text)
   display.setTextSize(2);
@@ -2857,7 +2938,7 @@ void drawArpSettingsScreen() {
   display.print(valueStr);
 
   // Editing indicator - brackets around value when editing
-  if (state.arpSettingsEditing) {
+  if (ui.state.arpSettingsEditing) {
     // Flashing brackets
     if ((millis() / 300) % 2) {
       display.setTextSize(2);
@@ -2874,7 +2955,7 @@ void drawArpSettingsScreen() {
   int dotsStartX = 64 - (8 * dotSpacing / 2) + 4;
   for (int i = 0; i < 8; i++) {
     int x = dotsStartX + (i * dotSpacing);
-    if (i == state.arpSettingsPage) {
+    if (i == ui.state.arpSettingsPage) {
       display.fillCircle(x, dotY, 3, WHITE);
     } else {
       display.drawCircle(x, dotY, 2, WHITE);
@@ -2882,11 +2963,11 @@ void drawArpSettingsScreen() {
   }
 }
 
-void drawSpecialModeScreen() {
-  if (state.inGenSettings) {
+void drawSpecialModeScreen(const UiSnapshot& ui) {
+  if (ui.state.inGenSettings) {
     // Generative settings submenu - compact
     display.setTextSize(1);
-    const char* label = (state.genSettingsPage == 0) ? "SPEED" : "TYPE";
+    const char* label = (ui.state.genSettingsPage == 0) ? "SPEED" : "TYPE";
     int labelLen = strlen(label);
     display.setCursor(64 - (labelLen * 3), 8);
     display.print(label);
@@ -2894,10 +2975,10 @@ void drawSpecialModeScreen() {
     // Setting value - large
     display.setTextSize(2);
     char valueStr[16];
-    if (state.genSettingsPage == 0) {
-      snprintf(valueStr, sizeof(valueStr), "%d%%", settings.genMutationRate);
+    if (ui.state.genSettingsPage == 0) {
+      snprintf(valueStr, sizeof(valueStr), "%d%%", ui.settings.genMutationRate);
     } else {
-      snprintf(valueStr, sizeof(valueStr), "%s", settings.genScaleMode ? "Chords" : "Scales");
+      snprintf(valueStr, sizeof(valueStr), "%s", ui.settings.genScaleMode ? "Chords" : "Scales");
     }
     int valLen = strlen(valueStr);
     display.setCursor(64 - (valLen * 6), 24);
@@ -2908,17 +2989,17 @@ void drawSpecialModeScreen() {
     int dotY = 52;
     for (int i = 0; i < 2; i++) {
       int x = 58 + (i * 12);
-      if (i == state.genSettingsPage) {
+      if (i == ui.state.genSettingsPage) {
         display.fillCircle(x, dotY, 3, WHITE);
       } else {
         display.drawCircle(x, dotY, 2, WHITE);
       }
     }
-  } else if (state.inGlideSettings) {
+  } else if (ui.state.inGlideSettings) {
     // Glide settings submenu - Time, Type, Max pages
     display.setTextSize(1);
     const char* labels[] = {"TIME", "TYPE", "MAX"};
-    const char* label = labels[state.glideSettingsPage];
+    const char* label = labels[ui.state.glideSettingsPage];
     int labelLen = strlen(label);
     display.setCursor(64 - (labelLen * 3), 8);
     display.print(label);
@@ -2926,21 +3007,21 @@ void drawSpecialModeScreen() {
     // Setting value - large
     display.setTextSize(2);
     char valueStr[16];
-    if (state.glideSettingsPage == 0) {
-      snprintf(valueStr, sizeof(valueStr), "%d", settings.glideTime);
-    } else if (state.glideSettingsPage == 1) {
-      snprintf(valueStr, sizeof(valueStr), "%s", settings.glideType == 0 ? "CC" : "BEND");
+    if (ui.state.glideSettingsPage == 0) {
+      snprintf(valueStr, sizeof(valueStr), "%d", ui.settings.glideTime);
+    } else if (ui.state.glideSettingsPage == 1) {
+      snprintf(valueStr, sizeof(valueStr), "%s", ui.settings.glideType == 0 ? "CC" : "BEND");
     } else {
       // Show max in seconds with 1 decimal
-      snprintf(valueStr, sizeof(valueStr), "%.1fs", settings.glideMaxMs / 1000.0f);
+      snprintf(valueStr, sizeof(valueStr), "%.1fs", ui.settings.glideMaxMs / 1000.0f);
     }
     int valLen = strlen(valueStr);
     display.setCursor(64 - (valLen * 6), 24);
     display.print(valueStr);
 
-    if (state.glideSettingsPage == 0) {
+    if (ui.state.glideSettingsPage == 0) {
       // Visual bar for time
-      int barWidth = map(settings.glideTime, 0, 127, 0, 100);
+      int barWidth = map(ui.settings.glideTime, 0, 127, 0, 100);
       display.drawRect(14, 48, 100, 8, WHITE);
       display.fillRect(14, 48, barWidth, 8, WHITE);
       display.setTextSize(1);
@@ -2948,10 +3029,10 @@ void drawSpecialModeScreen() {
       display.print("F");
       display.setCursor(118, 50);
       display.print("S");
-    } else if (state.glideSettingsPage == 1) {
+    } else if (ui.state.glideSettingsPage == 1) {
       // Description for type
       display.setTextSize(1);
-      const char* desc = settings.glideType == 0 ? "CC Portamento" : "Pitch Bend";
+      const char* desc = ui.settings.glideType == 0 ? "CC Portamento" : "Pitch Bend";
       int descLen = strlen(desc);
       display.setCursor(64 - (descLen * 3), 48);
       display.print(desc);
@@ -2966,7 +3047,7 @@ void drawSpecialModeScreen() {
     int dotY = 60;
     for (int i = 0; i < 3; i++) {
       int x = 52 + (i * 12);
-      if (i == state.glideSettingsPage) {
+      if (i == ui.state.glideSettingsPage) {
         display.fillCircle(x, dotY, 3, WHITE);
       } else {
         display.drawCircle(x, dotY, 2, WHITE);
@@ -2980,7 +3061,7 @@ void drawSpecialModeScreen() {
 
     // Current mode name - large
     display.setTextSize(2);
-    const char* modeName = specialModeNames[state.specialMode];
+    const char* modeName = specialModeNames[ui.state.specialMode];
     int nameLen = strlen(modeName);
     int nameX = 64 - (nameLen * 6);
     display.setCursor(nameX, 28);
@@ -2992,7 +3073,7 @@ void drawSpecialModeScreen() {
     int dotsStartX = 64 - (NUM_SPECIAL_MODES * dotSpacing / 2) + 7;
     for (int i = 0; i < NUM_SPECIAL_MODES; i++) {
       int x = dotsStartX + (i * dotSpacing);
-      if (i == state.specialMode) {
+      if (i == ui.state.specialMode) {
         display.fillCircle(x, dotY, 3, WHITE);
       } else {
         display.drawCircle(x, dotY, 2, WHITE);
@@ -3001,7 +3082,96 @@ void drawSpecialModeScreen() {
   }
 }
 
-void drawMaxNotesScreen() {
+void drawLooperMenuScreen(const UiSnapshot& ui) {
+  // Marquee style single-item menu (same as arp settings), for the selected track
+  // Items: Track, Length, Channel, Mute, Solo, Layer, Quantize, File
+
+  const char* labels[NUM_LOOPER_MENU_ITEMS] = {"TRACK", "LENGTH", "CHANNEL", "MUTE", "SOLO", "LAYER", "QUANTIZE", "FILE"};
+  const LoopTrack& tr = ui.looper.tracks[ui.looper.selectedTrack];
+  char valueStr[16];
+
+  switch (ui.state.looperMenuPage) {
+    case 0: // Track
+      snprintf(valueStr, sizeof(valueStr), "%d/%d", ui.looper.selectedTrack + 1, LOOP_TRACKS);
+      break;
+    case 1: // Length
+      snprintf(valueStr, sizeof(valueStr), "%s", loopLengthNames[tr.lengthBars]);
+      break;
+    case 2: // Channel
+      if (tr.channel == LOOP_CHANNEL_AS_RECORDED) {
+        snprintf(valueStr, sizeof(valueStr), "AS REC");
+      } else {
+        snprintf(valueStr, sizeof(valueStr), "CH %d", tr.channel + 1);
+      }
+      break;
+    case 3: // Mute
+      snprintf(valueStr, sizeof(valueStr), "%s", tr.muted ? "ON" : "OFF");
+      break;
+    case 4: // Solo
+      snprintf(valueStr, sizeof(valueStr), "%s", tr.soloed ? "ON" : "OFF");
+      break;
+    case 5: // Layer: visible / recorded
+      if (tr.layerCount == 0) {
+        snprintf(valueStr, sizeof(valueStr), "NONE");
+      } else {
+        snprintf(valueStr, sizeof(valueStr), "%d/%d", tr.visibleLayers, tr.layerCount);
+      }
+      break;
+    case 6: // Quantize
+      snprintf(valueStr, sizeof(valueStr), "%s", loopQuantizeNames[ui.looper.quantize]);
+      break;
+    case 7: // File - the result of the last job for a moment, then the action
+      if (ui.looper.fileStatus == LOOP_FILE_STATUS_BUSY) {
+        snprintf(valueStr, sizeof(valueStr), "...");
+      } else if (ui.looper.fileStatus != LOOP_FILE_STATUS_NONE && millis() - ui.looper.fileStatusTime < 1500) {
+        snprintf(valueStr, sizeof(valueStr), "%s", ui.looper.fileStatus == LOOP_FILE_STATUS_OK      ? "DONE"
+                                                 : ui.looper.fileStatus == LOOP_FILE_STATUS_PLAYING ? "STOP 1ST"
+                                                                                                    : "FAILED");
+      } else {
+        snprintf(valueStr, sizeof(valueStr), "%s", looperFileActionNames[ui.state.looperFileAction]);
+      }
+      break;
+  }
+
+  // Track at top left, label centered
+  display.setTextSize(1);
+  display.setCursor(0, 0);
+  display.print("T");
+  display.print(ui.looper.selectedTrack + 1);
+  int labelLen = strlen(labels[ui.state.looperMenuPage]);
+  display.setCursor(64 - (labelLen * 3), 8);
+  display.print(labels[ui.state.looperMenuPage]);
+
+  // Value in center
+  display.setTextSize(2);
+  int valLen = strlen(valueStr);
+  int valX = 64 - (valLen * 6);
+  display.setCursor(valX, 26);
+  display.print(valueStr);
+
+  // Editing indicator - flashing brackets around value
+  if (ui.state.looperMenuEditing && (millis() / 300) % 2) {
+    display.setCursor(valX - 12, 26);
+    display.print("<");
+    display.setCursor(valX + (valLen * 12), 26);
+    display.print(">");
+  }
+
+  // Page dots at bottom
+  int dotY = 56;
+  int dotSpacing = 9;
+  int dotsStartX = 64 - (NUM_LOOPER_MENU_ITEMS * dotSpacing / 2) + 4;
+  for (int i = 0; i < NUM_LOOPER_MENU_ITEMS; i++) {
+    int x = dotsStartX + (i * dotSpacing);
+    if (i == ui.state.looperMenuPage) {
+      display.fillCircle(x, dotY, 3, WHITE);
+    } else {
+      display.drawCircle(x, dotY, 2, WHITE);
+    }
+  }
+}
+
+void drawMaxNotesScreen(const UiSnapshot& ui) {
   // Header
   display.setTextSize(1);
   display.setCursor(0, 0);
@@ -3010,18 +3180,18 @@ void drawMaxNotesScreen() {
   // Big number in center
   display.setTextSize(4);
   display.setCursor(52, 18);
-  display.print(settings.maxNotesPerChord);
+  display.print(ui.settings.maxNotesPerChord);
 
   // Visual indicator - dots showing max notes (max 8)
   display.setTextSize(1);
   int dotY = 54;
   int dotSpacing = 14;  // Spacing between dots
   int startX = 64 - (8 * dotSpacing / 2) + dotSpacing / 2;  // Center 8 dots
-  for (int i = 0; i < settings.maxNotesPerChord; i++) {
+  for (int i = 0; i < ui.settings.maxNotesPerChord; i++) {
     display.fillCircle(startX + i * dotSpacing, dotY, 3, WHITE);
   }
   // Show empty slots (max 8)
-  for (int i = settings.maxNotesPerChord; i < 8; i++) {
+  for (int i = ui.settings.maxNotesPerChord; i < 8; i++) {
     display.drawCircle(startX + i * dotSpacing, dotY, 3, WHITE);
   }
 }
@@ -3093,7 +3263,7 @@ void drawPianoKeyboard(int baseNote, uint8_t* activeNotes, int numActive) {
 }
 
 // Draw piano keyboard with active notes filled and inactive (beyond max) notes dimmed
-void drawPianoKeyboardWithDimmed(int baseNote, uint8_t* activeNotes, int numActive, uint8_t* inactiveNotes, int numInactive) {
+void drawPianoKeyboardWithDimmed(int baseNote, const uint8_t* activeNotes, int numActive, const uint8_t* inactiveNotes, int numInactive) {
   int startNote = (baseNote / 12) * 12;
 
   const int whiteKeyW = 16;
@@ -3167,54 +3337,37 @@ void drawPianoKeyboardWithDimmed(int baseNote, uint8_t* activeNotes, int numActi
   }
 }
 
-void drawMainScreen() {
+void drawMainScreen(const UiSnapshot& ui) {
   // Playing state - show piano keyboard with pressed notes
-  if (state.activePad >= 0) {
-    ChordV2& chord = pads[state.activePad].chord;
-
+  if (ui.state.activePad >= 0) {
     // Top-left: root key info (tiny) - or preset indicator
     display.setTextSize(1);
     display.setCursor(0, 0);
-    if (state.inPresetMode) {
+    if (ui.state.inPresetMode) {
       display.fillCircle(3, 3, 2, WHITE);  // Small dot = preset mode
     } else {
-      display.print(midiNoteNames[settings.rootNote]);
+      display.print(midiNoteNames[ui.settings.rootNote]);
     }
 
     // Top-center: preset name or scale info
     display.setCursor(40, 0);
-    if (state.inPresetMode) {
-      display.print(presetBankInfo[state.currentPreset].name);
+    if (ui.state.inPresetMode) {
+      display.print(presetBankInfo[ui.state.currentPreset].name);
     } else {
-      display.print(scaleNames[settings.scaleType]);
+      display.print(scaleNames[ui.settings.scaleType]);
     }
 
     // Top-right: pad number
     display.setCursor(116, 0);
-    display.print(state.activePad + 1);
-
-    // Build arrays of active notes (within max) and inactive notes (beyond max)
-    uint8_t activeNotes[8];
-    uint8_t inactiveNotes[8];
-    int numActive = 0;
-    int numInactive = 0;
-    int chordRoot = settings.rootNote + chord.rootOffset + (state.currentOctave * 12);
-    chordRoot = constrain(chordRoot, 0, 127);
-
-    int noteCount = 0;
-    for (int i = 0; i < 8; i++) {
-      if (chord.isActive[i]) {
-        int note = chordRoot + chord.intervals[i];
-        if (note >= 0 && note <= 127) {
-          if (noteCount < settings.maxNotesPerChord) {
-            activeNotes[numActive++] = note;
-          } else {
-            inactiveNotes[numInactive++] = note;
-          }
-          noteCount++;
-        }
-      }
-    }
+    display.print(ui.state.activePad + 1);
+
+    // Active notes (within max) and inactive notes (beyond max)
+    const CompiledChord& chord = ui.activeChord;
+    int chordRoot = constrain(chord.rootNote, 0, 127);
+    const uint8_t* activeNotes = chord.note;
+    const uint8_t* inactiveNotes = chord.note + chord.count;
+    int numActive = chord.count;
+    int numInactive = chord.total - chord.count;
 
     // Draw piano keyboard with active/inactive notes
     drawPianoKeyboardWithDimmed(chordRoot, activeNotes, numActive, inactiveNotes, numInactive);
@@ -3222,34 +3375,34 @@ void drawMainScreen() {
     // Bottom bar: latch + arp + gen indicator + octave
     display.setTextSize(1);
     display.setCursor(0, 56);
-    if (state.latchMode) {
+    if (ui.state.latchMode) {
       display.print("LCH ");
     }
-    if (state.arpRate > 0) {
+    if (ui.state.arpRate > 0) {
       display.print("ARP ");
-      display.print(arpRateNames[state.arpRate]);
+      display.print(arpRateNames[ui.state.arpRate]);
       display.print(" ");
     }
-    if (state.specialMode == SPECIAL_MODE_GENERATIVE) {
+    if (ui.state.specialMode == SPECIAL_MODE_GENERATIVE) {
       display.print("GEN");
     }
 
     // Right side: octave and channel
     display.setCursor(85, 56);
-    if (state.currentOctave != 0) {
-      if (state.currentOctave > 0) display.print("+");
-      display.print(state.currentOctave);
+    if (ui.state.currentOctave != 0) {
+      if (ui.state.currentOctave > 0) display.print("+");
+      display.print(ui.state.currentOctave);
       display.print(" ");
     }
     // Channel (flash when changed)
-    bool channelFlash = (millis() - state.channelFlashTime) < 1000;
+    bool channelFlash = (millis() - ui.state.channelFlashTime) < 1000;
     if (channelFlash) {
       int chX = display.getCursorX();
       display.fillRect(chX, 54, 28, 10, WHITE);
       display.setTextColor(BLACK);
     }
     display.print("CH");
-    display.print(settings.midiOutputAChannel + 1);
+    display.print(ui.settings.midiOutputAChannel + 1);
     if (channelFlash) {
       display.setTextColor(WHITE);
     }
@@ -3260,10 +3413,10 @@ void drawMainScreen() {
     // Top: Preset name or Scale name centered
     display.setTextSize(1);
     const char* topText;
-    if (state.inPresetMode) {
-      topText = presetBankInfo[state.currentPreset].name;
+    if (ui.state.inPresetMode) {
+      topText = presetBankInfo[ui.state.currentPreset].name;
     } else {
-      topText = scaleNames[settings.scaleType];
+      topText = scaleNames[ui.settings.scaleType];
     }
     int topLen = strlen(topText);
     int topX = 64 - (topLen * 3);
@@ -3271,22 +3424,22 @@ void drawMainScreen() {
     display.print(topText);
 
     // Preset mode indicator (small filled dot on left)
-    if (state.inPresetMode) {
+    if (ui.state.inPresetMode) {
       display.fillCircle(4, 5, 2, WHITE);
     }
 
     // Clock indicator dot (top right, blinks on beat)
-    if (settings.midiClockSync) {
-      if (clockPulseIndicator && (millis() - lastClockPulseTime < 100)) {
+    if (ui.settings.midiClockSync) {
+      if (ui.clockPulseIndicator && (millis() - ui.lastClockPulseTime < 100)) {
         display.fillCircle(122, 5, 4, WHITE);
-      } else if (externalClockActive) {
+      } else if (ui.externalClockActive) {
         display.drawCircle(122, 5, 3, WHITE);
       }
     }
 
     // Center: Root note BIG 8-bit style
     display.setTextSize(3);
-    const char* rootName = midiNoteNames[settings.rootNote];
+    const char* rootName = midiNoteNames[ui.settings.rootNote];
     int rootLen = strlen(rootName);
     int rootX = 64 - (rootLen * 9);
     display.setCursor(rootX, 20);
@@ -3297,44 +3450,44 @@ void drawMainScreen() {
 
     // Left: Octave as +1/-1 etc
     display.setCursor(0, 56);
-    if (state.currentOctave != 0) {
-      if (state.currentOctave > 0) {
+    if (ui.state.currentOctave != 0) {
+      if (ui.state.currentOctave > 0) {
         display.print("+");
       }
-      display.print(state.currentOctave);
+      display.print(ui.state.currentOctave);
     } else {
       display.print("0");
     }
 
     // Center-left: LATCH indicator
-    if (state.latchMode) {
+    if (ui.state.latchMode) {
       display.setCursor(25, 56);
       display.print("LCH");
     }
 
     // Center: arp rate (if active)
-    if (state.arpRate > 0) {
+    if (ui.state.arpRate > 0) {
       display.setCursor(55, 56);
       display.print("ARP");
-      display.print(arpRateNames[state.arpRate]);
+      display.print(arpRateNames[ui.state.arpRate]);
     }
 
     // Right: channel (flash inverted when recently changed)
-    bool channelFlash = (millis() - state.channelFlashTime) < 1000;
+    bool channelFlash = (millis() - ui.state.channelFlashTime) < 1000;
     if (channelFlash) {
       display.fillRect(100, 54, 28, 10, WHITE);
       display.setTextColor(BLACK);
     }
     display.setCursor(102, 56);
     display.print("CH");
-    display.print(settings.midiOutputAChannel + 1);
+    display.print(ui.settings.midiOutputAChannel + 1);
     if (channelFlash) {
       display.setTextColor(WHITE);
     }
   }
 }
 
-void drawSettingsScreen() {
+void drawSettingsScreen(const UiSnapshot& ui) {
   // Single-item marquee style settings menu
   // Items: Channel, BPM, Clock Sync, Voice Mode
   // Scroll to change item, click to edit value, click to exit edit
@@ -3343,31 +3496,43 @@ void drawSettingsScreen() {
   char valueStr[16];
 
   // Get current item's value
-  switch (state.settingsPage) {
+  switch (ui.state.settingsPage) {
     case 0:  // Channel
-      snprintf(valueStr, sizeof(valueStr), "%d", settings.midiOutputAChannel + 1);
+      snprintf(valueStr, sizeof(valueStr), "%d", ui.settings.midiOutputAChannel + 1);
       break;
     case 1:  // BPM
-      if (externalClockActive) {
-        snprintf(valueStr, sizeof(valueStr), "%d*", detectedBpm);
+      if (ui.externalClockActive) {
+        snprintf(valueStr, sizeof(valueStr), "%d*", ui.detectedBpm);
       } else {
-        snprintf(valueStr, sizeof(valueStr), "%d", settings.internalBpm);
+        snprintf(valueStr, sizeof(valueStr), "%d", ui.settings.internalBpm);
       }
       break;
     case 2:  // Clock Sync
-      snprintf(valueStr, sizeof(valueStr), "%s", settings.midiClockSync ? "ON" : "OFF");
+      snprintf(valueStr, sizeof(valueStr), "%s", ui.settings.midiClockSync ? "ON" : "OFF");
       break;
     case 3:  // Voice Mode
-      snprintf(valueStr, sizeof(valueStr), "%s", settings.polyMode ? "POLY" : "MONO");
+      snprintf(valueStr, sizeof(valueStr), "%s", ui.settings.polyMode ? "POLY" : "MONO");
       break;
   }
 
   // Label at top (small)
   display.setTextSize(1);
-  int labelLen = strlen(menuItems[state.settingsPage]);
+  int labelLen = strlen(menuItems[ui.state.settingsPage]);
   int labelX = 64 - (labelLen * 3);
   display.setCursor(labelX, 8);
-  display.print(menuItems[state.settingsPage]);
+  display.print(menuItems[ui.state.settingsPage]);
+
+  // Locked to an external clock: the beat sweeps across the top of the BPM
+  // page, and the sync page shows how steady the incoming ticks are
+  if (ui.externalClockActive && ui.state.settingsPage == 1) {
+    display.drawFastHLine(0, 0, ((uint32_t)ui.clockBeatPhase * 128) >> 16, WHITE);
+  } else if (ui.externalClockActive && ui.state.settingsPage == 2) {
+    char jitterStr[16];
+    snprintf(jitterStr, sizeof(jitterStr), "JITTER %lu.%luMS",
+             (unsigned long)(ui.clockJitterUs / 1000), (unsigned long)(ui.clockJitterUs % 1000 / 100));
+    display.setCursor(64 - (strlen(jitterStr) * 3), 0);
+    display.print(jitterStr);
+  }
 
   // Value in center (BIG)
   display.setTextSize(3);
@@ -3377,7 +3542,7 @@ void drawSettingsScreen() {
   display.print(valueStr);
 
   // Editing indicator - brackets around value when editing
-  if (state.settingsEditing) {
+  if (ui.state.settingsEditing) {
     // Flashing brackets
     if ((millis() / 300) % 2) {
       display.setTextSize(3);
@@ -3394,7 +3559,7 @@ void drawSettingsScreen() {
   int dotsStartX = 64 - (4 * dotSpacing / 2) + 6;
   for (int i = 0; i < 4; i++) {
     int x = dotsStartX + (i * dotSpacing);
-    if (i == state.settingsPage) {
+    if (i == ui.state.settingsPage) {
       display.fillCircle(x, dotY, 4, WHITE);
     } else {
       display.drawCircle(x, dotY, 3, WHITE);
@@ -3405,19 +3570,38 @@ void drawSettingsScreen() {
 //================================ STORAGE ================================
 
 void loadSettings() {
-  File file = LittleFS.open("/v2settings.bin", "r");
+  if (settingsJournalLoad(settingsJournal, settings)) return;
+
+  // No journal yet: settings saved raw by an older firmware, moved over
+  // field by field (see settingsSchemaV2.h) on the next commit
+  File file = LittleFS.open(SETTINGS_LEGACY_PATH, "r");
   if (file) {
-    file.read((uint8_t*)&settings, sizeof(SettingsV2));
+    SettingsRawV1 raw;
+    if (file.size() == sizeof(raw) && file.read((uint8_t*)&raw, sizeof(raw)) == sizeof(raw)) {
+      settings = SettingsV2();
+      settingsJournal.fieldsRefused += settingsDecodeLegacy(settings, raw);
+      settingsJournalMarkDirty(settingsJournal);
+    }
     file.close();
   }
 }
 
+// Settings changed - written in the background once they settle (see settingsJournalV2.h)
 void saveSettings() {
-  File file = LittleFS.open("/v2settings.bin", "w");
-  if (file) {
-    file.write((uint8_t*)&settings, sizeof(SettingsV2));
-    file.close();
-  }
+  settingsJournalMarkDirty(settingsJournal);
+}
+
+// Room for a flash write: nothing sounding, and nothing due from the
+// scheduler or the looper while the flash stalls the cores
+bool flashWriteGap() {
+  if (voices.count > 0) return false;
+  uint32_t writeUs = SETTINGS_WRITE_MS * 1000UL;
+  return schedulerIdleUntil(scheduler, micros() + writeUs) && looperQuietFor(writeUs);
+}
+
+// Same for a settings write, which also waits for the loop file job
+bool settingsWriteGap() {
+  return !looperFileBusy() && flashWriteGap();
 }
 
 void initPadsFromPreset() {
@@ -3445,6 +3629,7 @@ void loadPreset(int presetIndex) {
     // Deep copy the chord data
     pads[i].chord = presetChords[i];
   }
+  chordCacheInvalidate(chordCache);
 }
 
 void loadScaleMode() {
@@ -3629,6 +3814,7 @@ void loadScaleMode() {
       chord.isActive[3] = true;
     }
   }
+  chordCacheInvalidate(chordCache);
 }
 
 //================================ INTERRUPTS ================================
@@ -3653,7 +3839,31 @@ void updateEncoder() {
   lastEncoded = encoded;
 }
 
+// Replace SerialUART's handler on UART0 with our own: every received byte is
+// timestamped into dinRxRing and the TX side drains the MIDI output queue.
+// FIFOs are disabled so each byte interrupts on arrival (no 32-bit-time RX
+// timeout delay) - at 31250 baud that is one IRQ per 320us at most.
+void initMidiUart() {
+  irq_set_enabled(UART0_IRQ, false);
+  irq_remove_handler(UART0_IRQ, irq_get_exclusive_handler(UART0_IRQ));
+  uart_set_fifo_enabled(MIDI_DIN_UART, false);
+  irq_set_exclusive_handler(UART0_IRQ, midiInterruptHandler);
+  uart_set_irq_enables(MIDI_DIN_UART, true, false);  // TX IRQ is armed by midiOutDrainDin
+  irq_set_enabled(UART0_IRQ, true);
+}
+
 void midiInterruptHandler() {
-  // No longer used - MIDI is polled in updateMIDI() for better clock handling
-  // Keep function to avoid removing interrupt attachment
+  uart_hw_t* hw = uart_get_hw(MIDI_DIN_UART);
+
+  // RX: stamp each byte as it lands
+  while (!(hw->fr & UART_UARTFR_RXFE_BITS)) {
+    uint32_t dr = hw->dr;
+    if (dr & UART_UARTDR_OE_BITS) {
+      dinRxRing.uartOverruns++;
+    }
+    midiRxRingPush(dinRxRing, dr & UART_UARTDR_DATA_BITS, micros());
+  }
+
+  // TX: shift out the next queued byte(s)
+  midiOutDrainDin();
 }
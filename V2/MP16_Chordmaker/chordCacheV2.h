@@ -0,0 +1,116 @@
+#ifndef CHORD_CACHE_V2_H
+#define CHORD_CACHE_V2_H
+
+//================================ CHORD CACHE DEFINES ================================
+// What each pad actually plays, worked out once instead of on every note:
+// final MIDI note (root + chord offset + interval + octave modifier + current
+// octave, clamped), output channel (A-D routing resolved), base velocity, and
+// which chord notes survive the max-notes limit.
+// The cache is rebuilt lazily on the next read when:
+//   - root, octave, max notes or output routing differ from the last build
+//     (compared on every read - a handful of ints)
+//   - chordCacheInvalidate() was called (pad chords reloaded: preset/scale)
+// Needs SettingsV2, RuntimeState and PadV2 - include after them.
+
+//================================ DATA STRUCTURES ================================
+
+struct CompiledChord {
+  uint8_t count = 0;         // Entries played: [0, count) are within max notes
+  uint8_t total = 0;         // All active chord notes: [count, total) are beyond max
+  uint8_t slot[8];           // Chord note index of each entry (voice slot, arp index)
+  uint8_t note[8];           // Final MIDI note
+  uint8_t channel[8];        // Output channel 0-15
+  int16_t velocity[8];       // Pad velocity + note modifier (before scaling/variation)
+  int8_t position[8];        // Chord note index -> entry, -1 if inactive
+  int16_t rootNote = 0;      // Chord root at the current octave (glide distance)
+};
+
+struct ChordCache {
+  CompiledChord pads[9];
+  bool valid = false;
+
+  // Inputs of the last build
+  int rootNote;
+  int octave;
+  int maxNotes;
+  int channels[4];
+
+  // Counters
+  uint16_t rebuilds = 0;
+};
+
+//================================ BUILD ================================
+
+inline int chordCacheChannel(const SettingsV2& s, int index) {
+  switch (index) {
+    case 1: return s.midiOutputBChannel;
+    case 2: return s.midiOutputCChannel;
+    case 3: return s.midiOutputDChannel;
+    default: return s.midiOutputAChannel;
+  }
+}
+
+void chordCacheCompile(CompiledChord& c, const PadV2& pad, const SettingsV2& s, int octave) {
+  const ChordV2& chord = pad.chord;
+  c.count = 0;
+  c.total = 0;
+  c.rootNote = s.rootNote + chord.rootOffset + octave * 12;
+
+  for (int j = 0; j < 8; j++) {
+    c.position[j] = -1;
+    if (!chord.isActive[j]) continue;
+
+    int note = s.rootNote + chord.rootOffset + chord.intervals[j]
+               + (chord.octaveModifiers[j] * 12) + (octave * 12);
+    uint8_t k = c.total++;
+    c.slot[k] = j;
+    c.note[k] = constrain(note, 0, 127);
+    c.channel[k] = chordCacheChannel(s, chord.channel[j]);
+    c.velocity[k] = pad.velocity + chord.velocityModifiers[j];
+    c.position[j] = k;
+    if (k < s.maxNotesPerChord) c.count++;
+  }
+}
+
+bool chordCacheCurrent(const ChordCache& cache, const SettingsV2& s, const RuntimeState& st) {
+  return cache.valid &&
+         cache.rootNote == s.rootNote &&
+         cache.octave == st.currentOctave &&
+         cache.maxNotes == s.maxNotesPerChord &&
+         cache.channels[0] == s.midiOutputAChannel &&
+         cache.channels[1] == s.midiOutputBChannel &&
+         cache.channels[2] == s.midiOutputCChannel &&
+         cache.channels[3] == s.midiOutputDChannel;
+}
+
+void chordCacheRebuild(ChordCache& cache, const PadV2* pads, const SettingsV2& s, const RuntimeState& st) {
+  for (int p = 0; p < 9; p++) {
+    chordCacheCompile(cache.pads[p], pads[p], s, st.currentOctave);
+  }
+  cache.rootNote = s.rootNote;
+  cache.octave = st.currentOctave;
+  cache.maxNotes = s.maxNotesPerChord;
+  cache.channels[0] = s.midiOutputAChannel;
+  cache.channels[1] = s.midiOutputBChannel;
+  cache.channels[2] = s.midiOutputCChannel;
+  cache.channels[3] = s.midiOutputDChannel;
+  cache.valid = true;
+  cache.rebuilds++;
+}
+
+//================================ PUBLIC API ================================
+
+// Pad chords were rewritten
+inline void chordCacheInvalidate(ChordCache& cache) {
+  cache.valid = false;
+}
+
+const CompiledChord& chordCacheGet(ChordCache& cache, int pad, const PadV2* pads,
+                                   const SettingsV2& s, const RuntimeState& st) {
+  if (!chordCacheCurrent(cache, s, st)) {
+    chordCacheRebuild(cache, pads, s, st);
+  }
+  return cache.pads[pad];
+}
+
+#endif // CHORD_CACHE_V2_H
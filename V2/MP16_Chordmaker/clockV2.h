@@ -0,0 +1,333 @@
+#ifndef CLOCK_V2_H
+#define CLOCK_V2_H
+
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+//================================ CLOCK TRACKER DEFINES ================================
+// One tempo tracker for incoming 0xF8 clock, fed by DIN and USB alike with the
+// byte's arrival time. A second-order (alpha-beta) PLL predicts when the next
+// tick is due and corrects phase and period a fraction of the error each tick,
+// so USB/loop jitter is averaged out but tempo changes are followed within a
+// beat. If ticks stop while the transport is running the tracker keeps
+// generating them at the tracked tempo for a while (free-wheel); real ticks
+// that turn up late (USB bursts) are matched against those instead of being
+// counted twice.
+
+#define CLOCK_MIN_PERIOD_US     8333     // 300 BPM
+#define CLOCK_MAX_PERIOD_US     125000   // 20 BPM
+#define CLOCK_LOST_US           500000   // No tick for this long (and not free-wheeling) = clock gone
+
+#define CLOCK_PLL_PHASE_SHIFT   2        // Phase correction 1/4 of the error per tick
+#define CLOCK_PLL_FREQ_SHIFT    5        // Period correction 1/32 of the error per tick
+#define CLOCK_PLL_FAST_TICKS    24       // After (re)acquiring, use double gains for one beat
+
+#define CLOCK_FREEWHEEL_TICKS   24       // Max ticks generated through a dropout (one beat)
+
+// Internal clock master: a hardware alarm sends 0xF8 from interrupt context
+// (DIN leaves immediately, USB on the next midiOutService). The tick period
+// 60,000,000 / (bpm * 24) = 2,500,000 / bpm µs is kept exact with a
+// remainder accumulator, and every alarm is scheduled from the previous
+// deadline rather than from "now", so there is no drift at any tempo.
+#define CLOCK_INTERNAL_US_PER_BEAT_24  2500000UL
+#define CLOCK_INTERNAL_PORTS           MIDI_OUT_TO_ALL
+
+enum ClockTrackerState : uint8_t {
+  CLOCK_IDLE,        // No external clock
+  CLOCK_ACQUIRING,   // One tick seen, waiting for a second to measure the period
+  CLOCK_LOCKED       // Tracking (possibly free-wheeling)
+};
+
+//================================ DATA STRUCTURES ================================
+
+struct ClockTracker {
+  ClockTrackerState state = CLOCK_IDLE;
+  uint8_t source = 0;            // Input we're locked to - the other one is ignored
+  bool freewheelAllowed = true;  // Cleared by Stop so a stopped DAW isn't played over
+
+  uint32_t lastTickUs = 0;       // Time of the last tick handed out (real or generated)
+  uint32_t lastRealUs = 0;       // Time of the last tick actually received
+  uint32_t expectedUs = 0;       // Predicted time of the next tick
+  uint8_t expectedFrac = 0;      // Sub-µs part of expectedUs (1/256 µs)
+  uint32_t periodQ8 = 0;         // Tracked tick period in 1/256 µs
+  uint8_t fastTicks = 0;         // Ticks left at acquisition gains
+
+  uint8_t aheadTicks = 0;        // Generated ticks not yet matched by real ones
+  bool resumed = false;          // An on-grid tick has arrived since the last generated one
+  uint32_t tickCount = 0;        // Ticks handed out since Start (24 per beat)
+
+  // Reported
+  uint16_t bpmX10 = 0;           // Tempo in 0.1 BPM
+  int32_t phaseErrorUs = 0;      // Last tick's arrival minus prediction
+  uint32_t jitterQ4 = 0;         // Smoothed |phaseError| in 1/16 µs
+
+  // Counters
+  uint16_t relocks = 0;          // Errors too large to track (tempo jump / missed ticks)
+  uint16_t freewheelTicks = 0;   // Ticks generated through dropouts
+  uint16_t ignoredTicks = 0;     // Ticks from the input we aren't locked to
+};
+
+struct InternalClock {
+  volatile bool running = false;
+  volatile uint16_t bpm = 120;         // Picked up at the next tick
+  uint16_t appliedBpm = 0;             // Tempo the accumulator is running at
+  uint16_t remainder = 0;              // Fractional µs owed, in 1/bpm µs
+  volatile uint16_t pendingTicks = 0;  // Ticks sent by the alarm, not yet handled by loop()
+  volatile uint32_t lastTickUs = 0;    // When the alarm sent the most recent one
+  alarm_id_t alarm = 0;
+
+  // Counters
+  uint16_t lateTicks = 0;              // Ticks sent before loop() handled the previous one
+};
+
+//================================ HELPERS ================================
+
+inline bool clockTrackerActive(const ClockTracker& c) {
+  return c.state != CLOCK_IDLE;
+}
+
+inline uint32_t clockTrackerTickUs(const ClockTracker& c) {
+  return c.periodQ8 >> 8;
+}
+
+inline uint32_t clockTrackerJitterUs(const ClockTracker& c) {
+  return c.jitterQ4 >> 4;
+}
+
+// Move the prediction on by one period, keeping the fraction
+void clockTrackerAdvance(ClockTracker& c) {
+  uint32_t sum = c.expectedFrac + c.periodQ8;
+  c.expectedUs += sum >> 8;
+  c.expectedFrac = sum & 0xFF;
+}
+
+void clockTrackerSetPeriod(ClockTracker& c, uint32_t periodQ8) {
+  c.periodQ8 = constrain(periodQ8, (uint32_t)CLOCK_MIN_PERIOD_US << 8, (uint32_t)CLOCK_MAX_PERIOD_US << 8);
+  // BPM = 60,000,000 / (period * 24); in 0.1 BPM with period in 1/256 µs
+  c.bpmX10 = (uint16_t)((25000000ULL << 8) / c.periodQ8);
+}
+
+// Start tracking from a single tick
+void clockTrackerAcquire(ClockTracker& c, uint8_t source, uint32_t t) {
+  c.state = CLOCK_ACQUIRING;
+  c.source = source;
+  c.lastTickUs = t;
+  c.lastRealUs = t;
+  c.aheadTicks = 0;
+}
+
+// Beat phase at time now: 0..65535 over one quarter note (24 ticks)
+uint16_t clockTrackerBeatPhase(const ClockTracker& c, uint32_t now) {
+  uint32_t period = clockTrackerTickUs(c);
+  uint32_t fracQ8 = 0;
+  if (period > 0) {
+    uint32_t elapsed = now - c.lastTickUs;
+    fracQ8 = (elapsed >= period) ? 255 : (elapsed << 8) / period;
+  }
+  // The first tick after Start is the downbeat
+  uint32_t pos = ((c.tickCount + 23) % 24) * 256 + fracQ8;   // 1/256 tick
+  return (uint16_t)(pos * 32 / 3);                             // * 65536 / (24 * 256)
+}
+
+//================================ TRACKING ================================
+
+// A real 0xF8 arrived at time t (micros). Returns true if it should be acted
+// on as a clock tick, false if it was absorbed (already generated during a
+// dropout) or came from the other input.
+bool clockTrackerTick(ClockTracker& c, uint8_t source, uint32_t t) {
+  if (c.state != CLOCK_IDLE && source != c.source) {
+    c.ignoredTicks++;
+    return false;
+  }
+
+  if (c.state == CLOCK_IDLE) {
+    clockTrackerAcquire(c, source, t);
+    c.tickCount++;
+    return true;
+  }
+
+  if (c.state == CLOCK_ACQUIRING) {
+    uint32_t interval = t - c.lastRealUs;
+    if (interval < CLOCK_MIN_PERIOD_US || interval > CLOCK_MAX_PERIOD_US) {
+      // Out of range - measure again from this tick
+      clockTrackerAcquire(c, source, t);
+    } else {
+      clockTrackerSetPeriod(c, interval << 8);
+      c.expectedUs = t;
+      c.expectedFrac = 0;
+      clockTrackerAdvance(c);
+      c.fastTicks = CLOCK_PLL_FAST_TICKS;
+      c.jitterQ4 = 0;
+      c.state = CLOCK_LOCKED;
+      c.lastTickUs = t;
+      c.lastRealUs = t;
+    }
+    c.tickCount++;
+    return true;
+  }
+
+  // Locked
+  int32_t err = (int32_t)(t - c.expectedUs);
+  int32_t half = (int32_t)(clockTrackerTickUs(c) / 2);
+
+  if (c.aheadTicks > 0) {
+    if (err < -half) {
+      // Well before the next slot: a late tick we already generated
+      c.aheadTicks--;
+      c.lastRealUs = t;
+      return false;
+    }
+    // On the grid. The first one may still be the head of a late burst;
+    // a second means the missing ticks were lost, not late
+    if (c.resumed) {
+      c.aheadTicks = 0;
+    }
+    c.resumed = true;
+  }
+
+  if (err > half || err < -half) {
+    // Too far off to be jitter: re-seed from the last interval
+    uint32_t interval = t - c.lastRealUs;
+    if (interval >= CLOCK_MIN_PERIOD_US && interval <= CLOCK_MAX_PERIOD_US) {
+      clockTrackerSetPeriod(c, interval << 8);
+    }
+    c.expectedUs = t;
+    c.expectedFrac = 0;
+    c.fastTicks = CLOCK_PLL_FAST_TICKS;
+    c.relocks++;
+  } else {
+    uint8_t phaseShift = CLOCK_PLL_PHASE_SHIFT;
+    uint8_t freqShift = CLOCK_PLL_FREQ_SHIFT;
+    if (c.fastTicks > 0) {
+      c.fastTicks--;
+      phaseShift--;
+      freqShift--;
+    }
+    c.expectedUs += (uint32_t)(err >> phaseShift);
+    clockTrackerSetPeriod(c, (uint32_t)((int32_t)c.periodQ8 + ((err * 256) >> freqShift)));
+
+    uint32_t absErr = (err < 0) ? -err : err;
+    c.jitterQ4 += (int32_t)((absErr << 4) - c.jitterQ4) / 16;
+  }
+  c.phaseErrorUs = err;
+
+  clockTrackerAdvance(c);
+  c.lastTickUs = t;
+  c.lastRealUs = t;
+  c.tickCount++;
+  return true;
+}
+
+// Call every loop pass. Returns true when a tick is due that never arrived
+// and should be generated (free-wheel). Also notices the clock going away.
+bool clockTrackerService(ClockTracker& c, uint32_t now) {
+  if (c.state == CLOCK_IDLE) return false;
+
+  if (c.state == CLOCK_LOCKED && c.freewheelAllowed) {
+    // Half a period late = missing, not jitter
+    if ((int32_t)(now - c.expectedUs) <= (int32_t)(clockTrackerTickUs(c) / 2)) {
+      return false;
+    }
+    if (c.aheadTicks < CLOCK_FREEWHEEL_TICKS) {
+      c.aheadTicks++;
+      c.resumed = false;
+      c.freewheelTicks++;
+      c.lastTickUs = c.expectedUs;
+      clockTrackerAdvance(c);
+      c.tickCount++;
+      return true;
+    }
+    c.state = CLOCK_IDLE;  // Dropout outlasted the free-wheel
+    return false;
+  }
+
+  if (now - c.lastRealUs > CLOCK_LOST_US) {
+    c.state = CLOCK_IDLE;
+  }
+  return false;
+}
+
+// Transport messages from the locked input (or any input while idle)
+void clockTrackerStart(ClockTracker& c) {
+  c.freewheelAllowed = true;
+  c.tickCount = 0;
+  c.aheadTicks = 0;
+}
+
+void clockTrackerContinue(ClockTracker& c) {
+  c.freewheelAllowed = true;
+}
+
+void clockTrackerStop(ClockTracker& c) {
+  c.freewheelAllowed = false;
+  c.aheadTicks = 0;
+}
+
+//================================ INTERNAL CLOCK ================================
+
+// Whole µs until the next tick, carrying the fraction forward
+uint32_t internalClockNextPeriod(InternalClock& c) {
+  if (c.bpm != c.appliedBpm) {
+    c.appliedBpm = constrain(c.bpm, 20, 300);
+    c.remainder = 0;
+  }
+  uint32_t period = CLOCK_INTERNAL_US_PER_BEAT_24 / c.appliedBpm;
+  c.remainder += CLOCK_INTERNAL_US_PER_BEAT_24 % c.appliedBpm;
+  if (c.remainder >= c.appliedBpm) {
+    c.remainder -= c.appliedBpm;
+    period++;
+  }
+  return period;
+}
+
+// Alarm callback (interrupt context)
+int64_t internalClockAlarm(alarm_id_t id, void* userData) {
+  InternalClock& c = *(InternalClock*)userData;
+  if (!c.running) return 0;
+
+  midiOutSendRealtimeIrq(0xF8, CLOCK_INTERNAL_PORTS);
+  c.lastTickUs = time_us_32();
+  c.pendingTicks++;
+  if (c.pendingTicks > 1) c.lateTicks++;
+
+  // Negative = relative to when this alarm was due, not to now
+  return -(int64_t)internalClockNextPeriod(c);
+}
+
+// Begin sending clock (with a Start first) - call from loop()
+void internalClockStart(InternalClock& c, uint16_t bpm) {
+  if (c.running) return;
+  c.bpm = bpm;
+  c.appliedBpm = 0;
+  c.pendingTicks = 0;
+  midiOutSendRealtime(0xFA, CLOCK_INTERNAL_PORTS);
+  c.running = true;
+  c.alarm = add_alarm_in_us(internalClockNextPeriod(c), internalClockAlarm, &c, true);
+}
+
+// Stop sending clock (followed by a Stop) - call from loop()
+void internalClockStop(InternalClock& c) {
+  if (!c.running) return;
+  c.running = false;
+  cancel_alarm(c.alarm);
+  c.pendingTicks = 0;
+  midiOutSendRealtime(0xFC, CLOCK_INTERNAL_PORTS);
+}
+
+// Ticks the alarm has sent since the last call (read and cleared atomically),
+// and when the last of them went out
+uint16_t internalClockTakeTicks(InternalClock& c, uint32_t& lastTickUs) {
+  uint32_t saved = save_and_disable_interrupts();
+  uint16_t ticks = c.pendingTicks;
+  c.pendingTicks = 0;
+  lastTickUs = c.lastTickUs;
+  restore_interrupts(saved);
+  return ticks;
+}
+
+// Current tick period in whole µs
+inline uint32_t internalClockTickUs(const InternalClock& c) {
+  return c.appliedBpm ? CLOCK_INTERNAL_US_PER_BEAT_24 / c.appliedBpm : 0;
+}
+
+#endif // CLOCK_V2_H
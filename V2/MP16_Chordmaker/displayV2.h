@@ -0,0 +1,120 @@
+#ifndef DISPLAY_V2_H
+#define DISPLAY_V2_H
+
+#include <Wire.h>
+
+//================================ DISPLAY FLUSH DEFINES ================================
+// Replaces display.display() for the main UI. A shadow copy of what the panel
+// is showing is kept; each flush compares the framebuffer against it page by
+// page (8 rows = 128 bytes) and only sends the column runs that changed, with
+// PAGEADDR/COLUMNADDR addressing. Static screens cost nothing on the bus.
+// updateDisplay also skips drawing entirely until the next frame is due.
+
+#define DISPLAY_MAX_FPS        30       // Frame cap for the main UI
+#define DISPLAY_FRAME_MS       (1000 / DISPLAY_MAX_FPS)
+#define DISPLAY_MERGE_GAP      8        // Unchanged bytes worth sending to avoid a new addressing transaction
+#define DISPLAY_I2C_CHUNK      128      // Data bytes per Wire transaction (buffer is 256)
+
+#define DISPLAY_PAGES          (SCREEN_HEIGHT / 8)
+#define DISPLAY_BUFFER_SIZE    (SCREEN_WIDTH * DISPLAY_PAGES)
+
+//================================ DATA STRUCTURES ================================
+
+struct DisplayFlushState {
+  uint8_t shadow[DISPLAY_BUFFER_SIZE];  // Last buffer contents the panel received
+  bool shadowValid = false;             // False = next flush sends everything
+  unsigned long lastFrameTime = 0;
+
+  // Counters
+  uint32_t framesSent = 0;              // Flushes that changed something
+  uint16_t lastFrameBytes = 0;          // Data bytes in the most recent flush
+};
+
+//================================ HELPERS ================================
+
+// Frame cap - true once per DISPLAY_FRAME_MS
+bool displayFrameDue(DisplayFlushState& f) {
+  unsigned long now = millis();
+  if (now - f.lastFrameTime < DISPLAY_FRAME_MS) return false;
+  f.lastFrameTime = now;
+  return true;
+}
+
+// Something other than displayFlush() wrote the panel (display.display(),
+// intro) - the shadow no longer matches it
+void displayFlushInvalidate(DisplayFlushState& f) {
+  f.shadowValid = false;
+}
+
+// Point the controller at one page and a column range
+void displaySetWindow(uint8_t addr, uint8_t page, uint8_t col0, uint8_t col1) {
+  Wire.beginTransmission(addr);
+  Wire.write((uint8_t)0x00);  // Command stream
+  Wire.write((uint8_t)SSD1306_PAGEADDR);
+  Wire.write(page);
+  Wire.write(page);
+  Wire.write((uint8_t)SSD1306_COLUMNADDR);
+  Wire.write(col0);
+  Wire.write(col1);
+  Wire.endTransmission();
+}
+
+void displaySendData(uint8_t addr, const uint8_t* data, uint16_t len) {
+  while (len > 0) {
+    uint16_t n = (len > DISPLAY_I2C_CHUNK) ? DISPLAY_I2C_CHUNK : len;
+    Wire.beginTransmission(addr);
+    Wire.write((uint8_t)0x40);  // Data stream
+    Wire.write(data, n);
+    Wire.endTransmission();
+    data += n;
+    len -= n;
+  }
+}
+
+//================================ FLUSH ================================
+
+// Send what changed since the last flush. Returns the data bytes sent.
+uint16_t displayFlush(Adafruit_SSD1306& d, DisplayFlushState& f, uint8_t addr) {
+  const uint8_t* buf = d.getBuffer();
+  uint16_t sent = 0;
+
+  for (uint8_t page = 0; page < DISPLAY_PAGES; page++) {
+    const uint8_t* row = buf + page * SCREEN_WIDTH;
+    uint8_t* shadowRow = f.shadow + page * SCREEN_WIDTH;
+
+    int col = 0;
+    while (col < SCREEN_WIDTH) {
+      // Find the next changed byte
+      if (f.shadowValid && row[col] == shadowRow[col]) {
+        col++;
+        continue;
+      }
+
+      // Extend the run until DISPLAY_MERGE_GAP unchanged bytes in a row
+      int start = col;
+      int end = col;
+      int same = 0;
+      for (col++; col < SCREEN_WIDTH && same < DISPLAY_MERGE_GAP; col++) {
+        if (!f.shadowValid || row[col] != shadowRow[col]) {
+          end = col;
+          same = 0;
+        } else {
+          same++;
+        }
+      }
+
+      displaySetWindow(addr, page, start, end);
+      displaySendData(addr, row + start, end - start + 1);
+      memcpy(shadowRow + start, row + start, end - start + 1);
+      sent += end - start + 1;
+      col = end + 1;
+    }
+  }
+
+  f.shadowValid = true;
+  f.lastFrameBytes = sent;
+  if (sent > 0) f.framesSent++;
+  return sent;
+}
+
+#endif // DISPLAY_V2_H
@@ -0,0 +1,144 @@
+#ifndef KEYS_V2_H
+#define KEYS_V2_H
+
+#include <hardware/gpio.h>
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+//================================ KEY SCAN DEFINES ================================
+// The 4x4 matrix, SHIFT and the encoder switch are sampled from a repeating
+// timer instead of loop(), so how fast a pad is seen doesn't depend on what
+// else ran that pass.
+//   - one matrix row per tick: read the columns of the row driven last tick
+//     (it has had a whole tick to settle), then drive the next row. Every key
+//     is sampled once per KEYS_ROWS ticks (1 ms)
+//   - each key has an integrating debounce counter: +1 per sample pressed,
+//     -1 per sample released, clamped to 0..KEYS_DEBOUNCE_SAMPLES. The key
+//     only changes state at either end, so a bounce never produces an event
+//   - a state change is queued as an event stamped with the time of the first
+//     sample of the run that caused it (the actual press or release)
+// Latency from contact to event is therefore fixed at KEYS_DEBOUNCE_SAMPLES ms.
+
+#define KEYS_ROWS              4
+#define KEYS_COLS              4
+#define KEYS_MATRIX            (KEYS_ROWS * KEYS_COLS)
+#define KEY_SHIFT              KEYS_MATRIX         // Direct pins after the matrix
+#define KEY_ENCODER            (KEYS_MATRIX + 1)
+#define KEYS_TOTAL             (KEYS_MATRIX + 2)
+
+#define KEYS_TICK_US           250      // One row per tick -> full scan every 1 ms
+#define KEYS_DEBOUNCE_SAMPLES  4        // Consecutive agreeing samples (ms) to change state
+#define KEYS_EVENT_QUEUE_SIZE  32       // Must be a power of 2
+
+//================================ DATA STRUCTURES ================================
+
+struct KeyEvent {
+  uint8_t key;         // 0-15 matrix, KEY_SHIFT, KEY_ENCODER
+  bool pressed;
+  uint32_t time;       // micros() of the edge
+};
+
+struct KeyScanner {
+  repeating_timer_t timer;
+  uint8_t row = 0;                         // Row currently driven low
+
+  uint8_t integrator[KEYS_TOTAL];
+  bool stable[KEYS_TOTAL];                 // Debounced state (timer side)
+  uint32_t edgeTime[KEYS_TOTAL];           // First sample of the current run
+
+  KeyEvent queue[KEYS_EVENT_QUEUE_SIZE];
+  volatile uint8_t head = 0;               // Written by the timer
+  volatile uint8_t tail = 0;               // Written by loop()
+
+  // Counters
+  uint16_t overflows = 0;                  // Events dropped because loop() fell behind
+};
+
+//================================ TIMER SIDE ================================
+
+const uint8_t keysRowPins[KEYS_ROWS] = {ROW0_PIN, ROW1_PIN, ROW2_PIN, ROW3_PIN};
+
+inline void keysDriveRow(uint8_t row) {
+  for (uint8_t r = 0; r < KEYS_ROWS; r++) {
+    gpio_put(keysRowPins[r], r != row);   // Active low
+  }
+}
+
+void keysSample(KeyScanner& k, uint8_t key, bool down, uint32_t now) {
+  uint8_t& n = k.integrator[key];
+  uint8_t before = n;
+
+  if (down) {
+    if (n < KEYS_DEBOUNCE_SAMPLES) n++;
+  } else {
+    if (n > 0) n--;
+  }
+  if ((before == 0 || before == KEYS_DEBOUNCE_SAMPLES) && n != before) {
+    k.edgeTime[key] = now;   // Left a rail - a change may be starting here
+  }
+
+  bool newState;
+  if (n == KEYS_DEBOUNCE_SAMPLES) newState = true;
+  else if (n == 0) newState = false;
+  else return;
+  if (newState == k.stable[key]) return;
+
+  k.stable[key] = newState;
+  uint8_t next = (k.head + 1) & (KEYS_EVENT_QUEUE_SIZE - 1);
+  if (next == k.tail) {
+    k.overflows++;
+    return;
+  }
+  KeyEvent& e = k.queue[k.head];
+  e.key = key;
+  e.pressed = newState;
+  e.time = k.edgeTime[key];
+  __dmb();
+  k.head = next;
+}
+
+bool keysTimerCallback(repeating_timer_t* t) {
+  KeyScanner& k = *(KeyScanner*)t->user_data;
+  uint32_t now = time_us_32();
+
+  // Columns of the row driven since the last tick (pulled up, low = pressed)
+  uint32_t cols = ~gpio_get_all() >> COL0_PIN;
+  for (uint8_t c = 0; c < KEYS_COLS; c++) {
+    keysSample(k, k.row * KEYS_COLS + c, (cols >> c) & 1, now);
+  }
+
+  // Direct switches once per full scan
+  if (k.row == 0) {
+    keysSample(k, KEY_SHIFT, !gpio_get(SHIFT_PIN), now);
+    keysSample(k, KEY_ENCODER, !gpio_get(ENCODER_S), now);
+  }
+
+  k.row = (k.row + 1) % KEYS_ROWS;
+  keysDriveRow(k.row);
+  return true;
+}
+
+//================================ PUBLIC API ================================
+
+// Pins must already be configured (rows OUTPUT, columns/switches INPUT_PULLUP)
+void keysInit(KeyScanner& k) {
+  for (uint8_t i = 0; i < KEYS_TOTAL; i++) {
+    k.integrator[i] = 0;
+    k.stable[i] = false;
+    k.edgeTime[i] = 0;
+  }
+  k.row = 0;
+  keysDriveRow(0);
+  add_repeating_timer_us(-KEYS_TICK_US, keysTimerCallback, &k, &k.timer);
+}
+
+// loop() side: next key event, if any
+bool keysPopEvent(KeyScanner& k, KeyEvent& e) {
+  if (k.tail == k.head) return false;
+  __dmb();
+  e = k.queue[k.tail];
+  k.tail = (k.tail + 1) & (KEYS_EVENT_QUEUE_SIZE - 1);
+  return true;
+}
+
+#endif // KEYS_V2_H
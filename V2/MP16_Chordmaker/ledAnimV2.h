@@ -0,0 +1,91 @@
+#ifndef LED_ANIM_V2_H
+#define LED_ANIM_V2_H
+
+//================================ LED ANIMATION DEFINES ================================
+// Integer-only LED brightness and animation, replacing the float dimColor()
+// and sin(millis()) math in updateVisuals (the RP2040 has no FPU).
+//   - brightness is a level 0..256 (256 = full), applied per channel with one
+//     multiply and shift: ledScale(color, level)
+//   - waveforms come from a 256-entry sine table indexed by a 32-bit phase
+//     accumulator: phase = millis() * phaseInc, top 8 bits = table index, so
+//     an LED's animation depends only on the clock and is the same every frame
+//   - each animated LED is declared once as a LedEffect (color, waveform,
+//     period, low/high level) and evaluated with ledEffectColor()
+
+#define LED_LEVEL_FULL        256
+#define LED_LEVEL(f)          ((int16_t)((f) * LED_LEVEL_FULL))   // Compile-time constants only
+
+// Phase increment per millisecond for a given period
+#define LED_PHASE_INC(ms)     ((uint32_t)(4294967296ULL / (ms)))
+// Period of sin(t / k): 2*pi*k milliseconds
+#define LED_SIN_PERIOD_MS(k)  ((uint32_t)(6.2831853 * (k)))
+
+enum LedWave : uint8_t {
+  LED_WAVE_STEADY,   // Always hi
+  LED_WAVE_BLINK,    // lo for the first half-period, hi for the second
+  LED_WAVE_PULSE     // Sine between lo and hi, starting at the midpoint
+};
+
+//================================ DATA STRUCTURES ================================
+
+struct LedEffect {
+  uint32_t color;
+  LedWave wave;
+  uint32_t phaseInc;   // LED_PHASE_INC(period)
+  int16_t lo;          // Levels, 0..256 (lo may be negative - clipped to off)
+  int16_t hi;
+};
+
+//================================ TABLES ================================
+
+// 127.5 + 127.5 * sin(2*pi*i/256)
+static const uint8_t ledSineTable[256] = {
+  128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+  176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+  218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+  245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+  255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+  245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+  218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+  176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+  128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  93,  90,  88,  85,  82,
+   79,  76,  73,  70,  67,  65,  62,  59,  57,  54,  52,  49,  47,  44,  42,  40,
+   37,  35,  33,  31,  29,  27,  25,  23,  21,  20,  18,  17,  15,  14,  12,  11,
+   10,   9,   7,   6,   5,   5,   4,   3,   2,   2,   1,   1,   1,   0,   0,   0,
+    0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+   10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+   37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+   79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+};
+
+//================================ HELPERS ================================
+
+// color * level / 256 per channel
+inline uint32_t ledScale(uint32_t color, uint16_t level) {
+  if (level >= LED_LEVEL_FULL) return color;
+  uint32_t r = (((color >> 16) & 0xFF) * level) >> 8;
+  uint32_t g = (((color >> 8) & 0xFF) * level) >> 8;
+  uint32_t b = ((color & 0xFF) * level) >> 8;
+  return (r << 16) | (g << 8) | b;
+}
+
+// Current level of an effect at nowMs
+inline uint16_t ledEffectLevel(const LedEffect& e, uint32_t nowMs) {
+  uint8_t index = (uint8_t)((nowMs * e.phaseInc) >> 24);
+  uint16_t w;  // 0..256
+  switch (e.wave) {
+    case LED_WAVE_BLINK: w = (index & 0x80) ? 256 : 0; break;
+    case LED_WAVE_PULSE: w = ledSineTable[index]; w += w >> 7; break;
+    default:             w = 256; break;
+  }
+  int32_t level = e.lo + (((int32_t)(e.hi - e.lo) * w) >> 8);
+  if (level < 0) level = 0;
+  if (level > LED_LEVEL_FULL) level = LED_LEVEL_FULL;
+  return (uint16_t)level;
+}
+
+inline uint32_t ledEffectColor(const LedEffect& e, uint32_t nowMs) {
+  return ledScale(e.color, ledEffectLevel(e, nowMs));
+}
+
+#endif // LED_ANIM_V2_H
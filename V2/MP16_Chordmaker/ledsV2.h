@@ -0,0 +1,142 @@
+#ifndef LEDS_V2_H
+#define LEDS_V2_H
+
+#include <hardware/pio.h>
+#include <hardware/dma.h>
+#include <hardware/clocks.h>
+
+//================================ LED OUTPUT DEFINES ================================
+// Replaces pixels.show(). The Adafruit_NeoPixel object is still the frame
+// buffer (setPixelColor/clear/brightness), but it never drives the pin:
+//   - the frame is compared against the last one sent; an unchanged frame
+//     costs one memcmp and nothing goes out
+//   - a changed frame is packed into 32-bit words and handed to a DMA channel
+//     that feeds a PIO state machine running the WS2812 bit timing, so the
+//     CPU returns immediately and interrupts stay enabled throughout
+// A frame that arrives while the previous one is still on the wire (or inside
+// the latch gap) is not lost: the shadow isn't updated, so the next call
+// sends it.
+
+#define LEDS_MAX_PIXELS     NUM_PIXELS
+#define LEDS_BIT_CYCLES     10          // PIO cycles per bit (T1 + T2 + T3)
+#define LEDS_BIT_HZ         800000      // WS2812 data rate
+#define LEDS_LATCH_US       300         // Low time that ends a frame (newer parts need >280us)
+
+// pioasm output for the standard ws2812 program (side-set 1, T1=2 T2=5 T3=3)
+static const uint16_t ledsWs2812Instructions[] = {
+  0x6221,  //  0: out    x, 1            side 0 [2]
+  0x1123,  //  1: jmp    !x, 3           side 1 [1]
+  0x1400,  //  2: jmp    0               side 1 [4]
+  0xa442,  //  3: nop                    side 0 [4]
+};
+
+static const struct pio_program ledsWs2812Program = {
+  ledsWs2812Instructions,
+  4,
+  -1
+};
+
+//================================ DATA STRUCTURES ================================
+
+struct LedOutput {
+  uint32_t words[LEDS_MAX_PIXELS];  // DMA source: GRB in the top 24 bits
+  uint8_t shadow[LEDS_MAX_PIXELS * 3];  // Bytes the strip is showing
+  bool shadowValid = false;
+  bool ready = false;               // PIO/DMA claimed - false falls back to pixels.show()
+
+  PIO pio;
+  uint sm;
+  int dmaChannel = -1;
+  uint32_t busyUntil = 0;           // micros() when the last frame and its latch are done
+
+  // Counters
+  uint32_t framesSent = 0;
+  uint32_t framesSkipped = 0;       // Identical to what's showing
+  uint32_t framesDeferred = 0;      // Previous frame still going out
+};
+
+//================================ SETUP ================================
+
+// Claim a state machine and DMA channel for the strip on pin. Call after
+// pixels.begin().
+void ledsInit(LedOutput& l, uint pin) {
+  l.pio = pio0;
+  if (!pio_can_add_program(l.pio, &ledsWs2812Program)) {
+    l.pio = pio1;
+    if (!pio_can_add_program(l.pio, &ledsWs2812Program)) return;
+  }
+  int sm = pio_claim_unused_sm(l.pio, false);
+  if (sm < 0) return;
+  int dma = dma_claim_unused_channel(false);
+  if (dma < 0) {
+    pio_sm_unclaim(l.pio, sm);
+    return;
+  }
+  l.sm = sm;
+  l.dmaChannel = dma;
+
+  uint offset = pio_add_program(l.pio, &ledsWs2812Program);
+  pio_gpio_init(l.pio, pin);
+  pio_sm_set_consistent_pindirs(l.pio, l.sm, pin, 1, true);
+
+  pio_sm_config c = pio_get_default_sm_config();
+  sm_config_set_wrap(&c, offset, offset + 3);
+  sm_config_set_sideset(&c, 1, false, false);
+  sm_config_set_sideset_pins(&c, pin);
+  sm_config_set_out_shift(&c, false, true, 24);   // MSB first, autopull every 24 bits
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+  sm_config_set_clkdiv(&c, (float)clock_get_hz(clk_sys) / (LEDS_BIT_HZ * LEDS_BIT_CYCLES));
+  pio_sm_init(l.pio, l.sm, offset, &c);
+  pio_sm_set_enabled(l.pio, l.sm, true);
+
+  dma_channel_config d = dma_channel_get_default_config(l.dmaChannel);
+  channel_config_set_transfer_data_size(&d, DMA_SIZE_32);
+  channel_config_set_read_increment(&d, true);
+  channel_config_set_write_increment(&d, false);
+  channel_config_set_dreq(&d, pio_get_dreq(l.pio, l.sm, true));
+  dma_channel_configure(l.dmaChannel, &d, &l.pio->txf[l.sm], l.words, 0, false);
+
+  l.ready = true;
+}
+
+//================================ SHOW ================================
+
+// Send the frame in px if it differs from what the strip shows.
+// Returns true if a frame was started.
+bool ledsShow(LedOutput& l, Adafruit_NeoPixel& px) {
+  if (!l.ready) {
+    px.show();
+    return true;
+  }
+
+  uint16_t n = px.numPixels();
+  if (n > LEDS_MAX_PIXELS) n = LEDS_MAX_PIXELS;
+  const uint8_t* bytes = px.getPixels();  // Already brightness-scaled, GRB order
+
+  if (l.shadowValid && memcmp(bytes, l.shadow, n * 3) == 0) {
+    l.framesSkipped++;
+    return false;
+  }
+
+  uint32_t now = micros();
+  if ((int32_t)(now - l.busyUntil) < 0 || dma_channel_is_busy(l.dmaChannel)) {
+    l.framesDeferred++;
+    return false;
+  }
+
+  for (uint16_t i = 0; i < n; i++) {
+    const uint8_t* p = bytes + i * 3;
+    l.words[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8);
+  }
+  memcpy(l.shadow, bytes, n * 3);
+  l.shadowValid = true;
+
+  dma_channel_transfer_from_buffer_now(l.dmaChannel, l.words, n);
+
+  // 24 bits at 1.25us each, then the latch gap
+  l.busyUntil = now + (n * 24 * 5) / 4 + LEDS_LATCH_US;
+  l.framesSent++;
+  return true;
+}
+
+#endif // LEDS_V2_H
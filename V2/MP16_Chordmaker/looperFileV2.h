@@ -0,0 +1,606 @@
+#ifndef LOOPER_FILE_V2_H
+#define LOOPER_FILE_V2_H
+
+//================================ LOOPER FILE DEFINES ================================
+// Saving/loading loops on LittleFS and exporting them as Standard MIDI Files.
+// All three run as a job that moves at most LOOP_FILE_CHUNK bytes per
+// updateLooperFile() call, so loop() never waits on one big write or read.
+//
+// Loop file (/loop.bin), little endian:
+//   "MPLP", version, track count
+//   per track: flags (bit0 content, bit1 muted, bit2 soloed), length option,
+//              channel, length in ticks (2 bytes)
+//   per track with content, in tick order:
+//              delta ticks (SMF variable length), note, velocityAndFlags, channelAndPad,
+//              sub-tick (version 2 on)
+//              other messages (version 3 on): kind << 4 (0xA0-0xE0) before
+//              the note byte, which is then data1, and velocityAndFlags data2
+//              ... then 0x00 0xFF (note 0xFF ends the track)
+//   only visible layers are written; they load back as one layer
+// A save is written to LOOP_FILE_TMP_PATH and renamed over /loop.bin only
+// once it is complete, so an abandoned or failed save keeps the last one.
+//
+// MIDI export (/loop.mid) at 960 PPQN (LOOP_SUBTICKS divisions per looper tick):
+//   - format 0: tempo, time signature and every audible track in one track
+//   - format 1: a conductor track, then one track per audible track
+//   - covers the longest exported track once; shorter tracks repeat to fill it
+//   - the records are handed to smfExportV2.h, which sorts each tick by
+//     sub-tick, drops note-offs without a note-on in the export and closes
+//     notes still on at the end; this file only walks the store and does
+//     the file I/O
+// Needs looperV2.h, smfV2.h and smfExportV2.h.
+
+#define LOOP_FILE_PATH        "/loop.bin"
+#define LOOP_FILE_TMP_PATH    "/loop.tmp"
+#define LOOP_FILE_MIDI_PATH   "/loop.mid"
+#define LOOP_FILE_MAGIC       "MPLP"
+#define LOOP_FILE_VERSION     3        // 1: no sub-tick byte, 2: notes only (both still load)
+#define LOOP_FILE_CHUNK       256      // Bytes per updateLooperFile() call
+#define LOOP_FILE_TRACK_BYTES 5
+#define LOOP_FILE_HEADER_MAX  (6 + LOOP_TRACKS * LOOP_FILE_TRACK_BYTES)
+#define LOOP_FILE_END_NOTE    0xFF
+
+// Job
+#define LOOP_FILE_IDLE    0
+#define LOOP_FILE_SAVE    1
+#define LOOP_FILE_LOAD    2
+#define LOOP_FILE_EXPORT  3
+
+// Result shown on the looper menu
+#define LOOP_FILE_STATUS_NONE   0
+#define LOOP_FILE_STATUS_BUSY   1
+#define LOOP_FILE_STATUS_OK     2
+#define LOOP_FILE_STATUS_ERROR  3
+#define LOOP_FILE_STATUS_PLAYING 4   // Refused: flash writes stall both cores, stop the looper first
+
+//================================ DATA STRUCTURES ================================
+
+// Walks looper records in tick order: for each tick, each track in mask.
+// A track shorter than length repeats.
+struct LoopCursor {
+  uint8_t mask = 0;
+  uint32_t length = 0;
+  uint32_t tick = 0;
+  uint8_t track = 0;             // Next track to look at for this tick
+  uint8_t eventTrack = 0;        // Track of the bucket being walked
+  uint16_t index = LOOP_NONE;    // Next record in that bucket
+};
+
+struct LoopFileJob {
+  uint8_t op = LOOP_FILE_IDLE;
+  uint8_t phase = 0;
+  File file;
+  uint8_t buf[LOOP_FILE_CHUNK + SMF_MAX_EVENT_BYTES];
+  uint16_t len = 0;              // Bytes in buf
+  uint32_t flushed = 0;          // Bytes already in the file
+  uint32_t generation = 0;       // looper store generation at the start
+
+  uint8_t mask = 0;              // Tracks being saved/loaded/exported
+
+  // Save / export
+  uint8_t track = 0;
+  uint32_t lastTick = 0;
+  LoopCursor cursor;
+
+  // Export
+  uint8_t smfFormat = SMF_FORMAT_MULTI;
+  uint16_t bpm = 120;
+  uint32_t exportTicks = 0;
+  SmfExportTrack exporter;
+  uint32_t smfTrackPos = 0;      // File offset of the current MTrk header
+
+  // Load
+  uint8_t header[LOOP_FILE_HEADER_MAX];
+  uint8_t headerLen = 0;
+  uint8_t headerNeed = 6;
+  uint8_t trackCount = 0;
+  uint8_t version = 0;
+  uint8_t field = 0;             // Byte of the current event record
+  uint32_t delta = 0;
+  uint8_t deltaBytes = 0;
+  uint32_t tick = 0;
+  LoopEvent evt;
+};
+
+extern LoopFileJob loopFile;
+
+//================================ CURSOR ================================
+
+void loopCursorStart(LoopCursor& c, uint8_t mask, uint32_t length) {
+  c.mask = mask;
+  c.length = length;
+  c.tick = 0;
+  c.track = 0;
+  c.index = LOOP_NONE;
+}
+
+// Next record; false at the end. Undone layers are left out.
+bool loopCursorNext(LoopCursor& c, const LoopEvent*& evt) {
+  while (c.tick < c.length) {
+    if (c.index != LOOP_NONE) {
+      evt = &loopStore.pool[c.index];
+      if (evt->layer >= looper.tracks[c.eventTrack].visibleLayers) {
+        c.index = LOOP_NONE;  // The rest of the bucket is hidden too
+        continue;
+      }
+      c.index = evt->next;
+      return true;
+    }
+    if (c.track >= LOOP_TRACKS) {
+      c.track = 0;
+      c.tick++;
+      continue;
+    }
+    uint8_t t = c.track++;
+    uint32_t trackLen = looper.tracks[t].lengthTicks;
+    if (!(c.mask & (1 << t)) || trackLen == 0) continue;
+    uint32_t tick = c.tick % trackLen;
+    if (tick >= LOOP_MAX_TICKS) continue;
+    c.eventTrack = t;
+    c.index = loopStore.bucketHead[t][tick];
+  }
+  return false;
+}
+
+//================================ HELPERS ================================
+
+bool looperFileFlush(LoopFileJob& j) {
+  if (j.len == 0) return true;
+  size_t n = j.file.write(j.buf, j.len);
+  j.flushed += n;
+  bool ok = (n == j.len);
+  j.len = 0;
+  return ok;
+}
+
+void looperFileFinish(LoopFileJob& j, bool ok) {
+  if (j.op == LOOP_FILE_LOAD) {
+    if (!ok && looper.loading) {
+      // Half a loop is worse than none (the store was already cleared for it)
+      looperStoreClear();
+      for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+        looper.tracks[t].hasContent = false;
+      }
+    }
+    looper.loading = false;
+    looperUpdateFlags();
+  }
+  if (j.file) j.file.close();
+  if (j.op == LOOP_FILE_SAVE) {
+    // LittleFS renames atomically - /loop.bin is the old save or the new one
+    if (!ok || !LittleFS.rename(LOOP_FILE_TMP_PATH, LOOP_FILE_PATH)) {
+      LittleFS.remove(LOOP_FILE_TMP_PATH);
+      ok = false;
+    }
+  }
+  j.op = LOOP_FILE_IDLE;
+  looper.fileStatus = ok ? LOOP_FILE_STATUS_OK : LOOP_FILE_STATUS_ERROR;
+  looper.fileStatusTime = millis();
+}
+
+// Next track in mask at or after from, LOOP_TRACKS if none
+uint8_t looperFileNextTrack(uint8_t mask, uint8_t from) {
+  while (from < LOOP_TRACKS && !(mask & (1 << from))) from++;
+  return from;
+}
+
+uint8_t looperFileContentMask() {
+  uint8_t mask = 0;
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    if (looper.tracks[t].hasContent && looper.tracks[t].lengthTicks > 0) mask |= 1 << t;
+  }
+  return mask;
+}
+
+inline uint8_t looperFileChannel(const LoopEvent& evt, uint8_t track) {
+  uint8_t ch = looper.tracks[track].channel;
+  return (ch == LOOP_CHANNEL_AS_RECORDED) ? LOOP_EVENT_CHANNEL(evt) : ch;
+}
+
+//================================ SAVE ================================
+
+#define LOOP_SAVE_HEADER  0
+#define LOOP_SAVE_EVENTS  1
+
+void looperFileSaveStep(LoopFileJob& j) {
+  if (j.phase == LOOP_SAVE_HEADER) {
+    uint8_t* p = j.buf;
+    memcpy(p, LOOP_FILE_MAGIC, 4);
+    p[4] = LOOP_FILE_VERSION;
+    p[5] = LOOP_TRACKS;
+    p += 6;
+    for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+      const LoopTrack& tr = looper.tracks[t];
+      bool content = j.mask & (1 << t);
+      p[0] = (content ? 0x01 : 0) | (tr.muted ? 0x02 : 0) | (tr.soloed ? 0x04 : 0);
+      p[1] = tr.lengthBars;
+      p[2] = tr.channel;
+      p[3] = tr.lengthTicks & 0xFF;
+      p[4] = tr.lengthTicks >> 8;
+      p += LOOP_FILE_TRACK_BYTES;
+    }
+    j.len = p - j.buf;
+    j.track = looperFileNextTrack(j.mask, 0);
+    if (j.track < LOOP_TRACKS) {
+      loopCursorStart(j.cursor, 1 << j.track, looper.tracks[j.track].lengthTicks);
+    }
+    j.lastTick = 0;
+    j.phase = LOOP_SAVE_EVENTS;
+  } else {
+    while (j.track < LOOP_TRACKS && j.len < LOOP_FILE_CHUNK) {
+      const LoopEvent* evt;
+      if (loopCursorNext(j.cursor, evt)) {
+        j.len += smfPutVarLen(j.buf + j.len, j.cursor.tick - j.lastTick);
+        j.lastTick = j.cursor.tick;
+        if (!LOOP_EVENT_IS_NOTE(*evt)) j.buf[j.len++] = evt->kind << 4;
+        j.buf[j.len++] = evt->note;
+        j.buf[j.len++] = evt->velocityAndFlags;
+        j.buf[j.len++] = evt->channelAndPad;
+        j.buf[j.len++] = evt->subTick & LOOP_SUB_MASK;
+      } else {
+        // End of this track
+        j.buf[j.len++] = 0;
+        j.buf[j.len++] = LOOP_FILE_END_NOTE;
+        j.track = looperFileNextTrack(j.mask, j.track + 1);
+        if (j.track < LOOP_TRACKS) {
+          loopCursorStart(j.cursor, 1 << j.track, looper.tracks[j.track].lengthTicks);
+        }
+        j.lastTick = 0;
+      }
+    }
+  }
+
+  if (!looperFileFlush(j)) {
+    looperFileFinish(j, false);
+  } else if (j.phase == LOOP_SAVE_EVENTS && j.track >= LOOP_TRACKS) {
+    looperFileFinish(j, true);
+  }
+}
+
+//================================ LOAD ================================
+
+#define LOOP_LOAD_HEADER  0
+#define LOOP_LOAD_EVENTS  1
+#define LOOP_LOAD_DONE    2
+
+// "MPLP", a version we read, a track count we have room for
+bool looperFileHeaderValid(const uint8_t h[6]) {
+  return memcmp(h, LOOP_FILE_MAGIC, 4) == 0 && h[4] != 0 && h[4] <= LOOP_FILE_VERSION &&
+         h[5] != 0 && h[5] <= LOOP_TRACKS;
+}
+
+// Header complete: set up the tracks. False if it isn't a loop file we read.
+bool looperFileApplyHeader(LoopFileJob& j) {
+  const uint8_t* h = j.header;
+  for (uint8_t t = 0; t < j.trackCount; t++) {
+    const uint8_t* p = h + 6 + t * LOOP_FILE_TRACK_BYTES;
+    LoopTrack& tr = looper.tracks[t];
+    uint32_t ticks = p[3] | (p[4] << 8);
+    if (p[1] >= NUM_LOOP_LENGTHS || ticks > LOOP_MAX_TICKS) return false;
+    if ((p[0] & 0x01) && ticks == 0) return false;
+    tr = LoopTrack();
+    tr.lengthBars = p[1];
+    tr.lengthTicks = ticks;
+    tr.channel = (p[2] < 16) ? p[2] : LOOP_CHANNEL_AS_RECORDED;
+    tr.muted = p[0] & 0x02;
+    tr.soloed = p[0] & 0x04;
+    tr.hasContent = p[0] & 0x01;
+    if (tr.hasContent) {
+      tr.layerCount = 1;  // Layers are merged on save
+      tr.visibleLayers = 1;
+      j.mask |= 1 << t;
+    }
+  }
+  return true;
+}
+
+// Feed one byte. False on a malformed file.
+bool looperFileLoadByte(LoopFileJob& j, uint8_t b) {
+  if (j.phase == LOOP_LOAD_HEADER) {
+    j.header[j.headerLen++] = b;
+    if (j.headerLen < j.headerNeed) return true;
+    if (j.headerNeed == 6) {
+      if (!looperFileHeaderValid(j.header)) return false;
+      j.version = j.header[4];
+      j.trackCount = j.header[5];
+      j.headerNeed = 6 + j.trackCount * LOOP_FILE_TRACK_BYTES;
+      return true;
+    }
+    if (!looperFileApplyHeader(j)) return false;
+    j.track = looperFileNextTrack(j.mask, 0);
+    j.phase = (j.track < LOOP_TRACKS) ? LOOP_LOAD_EVENTS : LOOP_LOAD_DONE;
+    j.tick = 0;
+    j.field = 0;
+    j.delta = 0;
+    j.deltaBytes = 0;
+    return true;
+  }
+
+  if (j.phase != LOOP_LOAD_EVENTS) return true;  // Trailing bytes are ignored
+
+  switch (j.field) {
+    case 0:  // Delta ticks
+      j.delta = (j.delta << 7) | (b & 0x7F);
+      if (++j.deltaBytes > 4) return false;
+      if (b & 0x80) return true;
+      j.tick += j.delta;
+      j.delta = 0;
+      j.deltaBytes = 0;
+      j.evt.kind = LOOP_KIND_NOTE;
+      j.field = 1;
+      return true;
+    case 1:  // Note, or end of track
+      if (b == LOOP_FILE_END_NOTE) {
+        j.track = looperFileNextTrack(j.mask, j.track + 1);
+        j.phase = (j.track < LOOP_TRACKS) ? LOOP_LOAD_EVENTS : LOOP_LOAD_DONE;
+        j.tick = 0;
+        j.field = 0;
+        return true;
+      }
+      if (b > 127) {
+        // Another channel message follows (once per record)
+        if (j.version < 3 || !LOOP_EVENT_IS_NOTE(j.evt) || b < 0xA0 || b > 0xE0 || (b & 0x0F)) return false;
+        j.evt.kind = b >> 4;
+        return true;
+      }
+      if (j.tick >= looper.tracks[j.track].lengthTicks) return false;
+      j.evt.note = b;
+      j.evt.subTick = 0;
+      j.evt.layer = 0;
+      j.field = 2;
+      return true;
+    case 2:
+      if (!LOOP_EVENT_IS_NOTE(j.evt) && (b & 0x80)) return false;
+      j.evt.velocityAndFlags = b;
+      j.field = 3;
+      return true;
+    case 3:
+      j.evt.channelAndPad = b;
+      if (j.version >= 2) {
+        j.field = 4;
+        return true;
+      }
+      j.field = 0;
+      return looperStoreAppend(j.track, j.tick, j.evt);
+    default:
+      if ((b & LOOP_SUB_MASK) >= LOOP_SUBTICKS) return false;
+      j.evt.subTick = b & LOOP_SUB_MASK;
+      j.field = 0;
+      return looperStoreAppend(j.track, j.tick, j.evt);
+  }
+}
+
+void looperFileLoadStep(LoopFileJob& j) {
+  int n = j.file.read(j.buf, LOOP_FILE_CHUNK);
+  if (n <= 0) {
+    // End of file: complete only if every track ended
+    looperFileFinish(j, j.phase == LOOP_LOAD_DONE);
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    if (!looperFileLoadByte(j, j.buf[i])) {
+      looperFileFinish(j, false);
+      return;
+    }
+  }
+  if (j.phase == LOOP_LOAD_DONE) looperFileFinish(j, true);
+}
+
+//================================ MIDI EXPORT ================================
+
+#define LOOP_EXPORT_HEADER  0
+#define LOOP_EXPORT_TRACKS  1
+#define LOOP_EXPORT_DONE    2
+
+// Export source: the cursor's records as channel messages
+bool looperFileExportNext(void* ctx, SmfExportEvent& e) {
+  LoopCursor& c = *(LoopCursor*)ctx;
+  const LoopEvent* evt;
+  if (!loopCursorNext(c, evt)) return false;
+  uint8_t ch = looperFileChannel(*evt, c.eventTrack);
+  e.tick = c.tick;
+  e.subTick = LOOP_EVENT_SUB(*evt);
+  e.data1 = evt->note;
+  if (LOOP_EVENT_IS_NOTE(*evt)) {
+    e.status = (LOOP_EVENT_IS_OFF(*evt) ? 0x80 : 0x90) | ch;
+    e.data2 = LOOP_EVENT_VELOCITY(*evt);
+  } else {
+    e.status = (evt->kind << 4) | ch;
+    e.data2 = LOOP_EVENT_DATA2(*evt);
+  }
+  return true;
+}
+
+// Flush, then write the finished track's length into its header
+bool looperFileEndSmfTrack(LoopFileJob& j) {
+  if (!looperFileFlush(j)) return false;
+  uint8_t len[4];
+  smfPatchTrackLength(j.exporter.smf, len);
+  uint32_t end = j.flushed;
+  if (!j.file.seek(j.smfTrackPos + 4)) return false;
+  if (j.file.write(len, 4) != 4) return false;
+  return j.file.seek(end);
+}
+
+// Start an MTrk for the events of mask (format 0: tempo map too)
+void looperFileBeginSmfTrack(LoopFileJob& j, uint8_t mask, bool withTempo) {
+  j.smfTrackPos = j.flushed + j.len;
+  loopCursorStart(j.cursor, mask, j.exportTicks);
+  j.len += smfExportBegin(j.exporter, j.buf + j.len, looperFileExportNext, &j.cursor,
+                          LOOP_SUBTICKS, j.exportTicks * LOOP_SUBTICKS);
+  if (withTempo) {
+    j.len += smfEncodeTempo(j.exporter.smf, j.buf + j.len, 0, smfTempoFromBpm(j.bpm));
+    j.len += smfEncodeTimeSignature(j.exporter.smf, j.buf + j.len, 0, 4, 2);
+  }
+}
+
+void looperFileExportStep(LoopFileJob& j) {
+  bool ok = true;
+
+  if (j.phase == LOOP_EXPORT_HEADER) {
+    uint8_t tracks = 1;
+    if (j.smfFormat == SMF_FORMAT_MULTI) {
+      for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+        if (j.mask & (1 << t)) tracks++;
+      }
+    }
+    j.len += smfWriteHeader(j.buf, j.smfFormat, tracks, LOOP_TICKS_PER_BEAT * LOOP_SUBTICKS);
+
+    if (j.smfFormat == SMF_FORMAT_MULTI) {
+      // Conductor track, then the first looper track
+      looperFileBeginSmfTrack(j, 0, true);
+      j.len += smfEncodeEndOfTrack(j.exporter.smf, j.buf + j.len, 0);
+      ok = looperFileEndSmfTrack(j);
+      j.track = looperFileNextTrack(j.mask, 0);
+      looperFileBeginSmfTrack(j, 1 << j.track, false);
+    } else {
+      looperFileBeginSmfTrack(j, j.mask, true);
+    }
+    j.phase = LOOP_EXPORT_TRACKS;
+  }
+
+  while (ok && j.phase == LOOP_EXPORT_TRACKS && j.len < LOOP_FILE_CHUNK) {
+    j.len += smfExportStep(j.exporter, j.buf + j.len);
+    if (!smfExportDone(j.exporter)) continue;
+
+    ok = looperFileEndSmfTrack(j);
+    j.track = (j.smfFormat == SMF_FORMAT_MULTI) ? looperFileNextTrack(j.mask, j.track + 1) : LOOP_TRACKS;
+    if (j.track < LOOP_TRACKS) {
+      looperFileBeginSmfTrack(j, 1 << j.track, false);
+    } else {
+      j.phase = LOOP_EXPORT_DONE;
+    }
+  }
+
+  if (ok) ok = looperFileFlush(j);
+  if (!ok) {
+    looperFileFinish(j, false);
+  } else if (j.phase == LOOP_EXPORT_DONE) {
+    looperFileFinish(j, true);
+  }
+}
+
+//================================ PUBLIC API ================================
+
+bool looperFileBusy() {
+  return loopFile.op != LOOP_FILE_IDLE;
+}
+
+// Show why a job couldn't start (nothing was touched)
+void looperFileRefuse(uint8_t status = LOOP_FILE_STATUS_ERROR) {
+  looper.fileStatus = status;
+  looper.fileStatusTime = millis();
+}
+
+bool looperFileOpen(LoopFileJob& j, uint8_t op, const char* path, const char* mode) {
+  if (j.op != LOOP_FILE_IDLE) return false;
+  j.file = LittleFS.open(path, mode);
+  if (!j.file) {
+    looperFileRefuse();
+    return false;
+  }
+  j.op = op;
+  j.phase = 0;
+  j.len = 0;
+  j.flushed = 0;
+  j.generation = looper.storeGeneration;
+  looper.fileStatus = LOOP_FILE_STATUS_BUSY;
+  return true;
+}
+
+// Save every track with content to LOOP_FILE_PATH (by way of LOOP_FILE_TMP_PATH)
+bool looperFileStartSave() {
+  if (looper.playing) {
+    looperFileRefuse(LOOP_FILE_STATUS_PLAYING);
+    return false;
+  }
+  uint8_t mask = looperFileContentMask();
+  if (!looperFileOpen(loopFile, LOOP_FILE_SAVE, LOOP_FILE_TMP_PATH, "w")) return false;
+  loopFile.mask = mask;
+  return true;
+}
+
+// Replace the loop with LOOP_FILE_PATH. The looper stops while it loads.
+// The current loop is only dropped once the file is there and starts with a
+// header we read - no saved loop (or a foreign file) leaves it alone.
+bool looperFileStartLoad() {
+  if (looperFileBusy()) return false;
+  if (!looperFileOpen(loopFile, LOOP_FILE_LOAD, LOOP_FILE_PATH, "r")) return false;
+  uint8_t header[6];
+  if (loopFile.file.read(header, sizeof(header)) != sizeof(header) ||
+      !looperFileHeaderValid(header) || !loopFile.file.seek(0)) {
+    looperFileFinish(loopFile, false);
+    return false;
+  }
+
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    looperSilenceTrack(t);
+  }
+  looper.playing = false;
+  looper.loading = true;
+  looper.transportTick = 0;
+  looperStoreClear();
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    looper.tracks[t] = LoopTrack();
+  }
+  loopFile.mask = 0;
+  loopFile.headerLen = 0;
+  loopFile.headerNeed = 6;
+  loopFile.generation = looper.storeGeneration;
+  looperUpdateFlags();
+  return true;
+}
+
+// Export the audible tracks with content to LOOP_FILE_MIDI_PATH
+bool looperFileStartExport(uint8_t smfFormat, uint16_t bpm) {
+  if (looper.playing) {
+    looperFileRefuse(LOOP_FILE_STATUS_PLAYING);
+    return false;
+  }
+  uint8_t mask = 0;
+  uint32_t ticks = 0;
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    const LoopTrack& tr = looper.tracks[t];
+    if (!tr.hasContent || tr.lengthTicks == 0 || !looperTrackAudible(looper, t)) continue;
+    mask |= 1 << t;
+    if (tr.lengthTicks > ticks) ticks = tr.lengthTicks;
+  }
+  if (mask == 0) {
+    looperFileRefuse();
+    return false;
+  }
+  if (!looperFileOpen(loopFile, LOOP_FILE_EXPORT, LOOP_FILE_MIDI_PATH, "w")) return false;
+  loopFile.smfFormat = smfFormat;
+  loopFile.bpm = bpm;
+  loopFile.mask = mask;
+  loopFile.exportTicks = ticks;
+  return true;
+}
+
+// Advance the running job by one chunk (called from loop()). Saves and
+// exports write flash, which stalls both cores with interrupts off: they
+// only step when writeGap says nothing is due for a while (live pads, arp).
+// A load only reads, which doesn't stall.
+void updateLooperFile(bool writeGap) {
+  LoopFileJob& j = loopFile;
+  switch (j.op) {
+    case LOOP_FILE_SAVE:
+    case LOOP_FILE_EXPORT:
+      if (!writeGap) return;
+      // A track was cleared under us - its records may be on the free list now
+      if (j.generation != looper.storeGeneration) {
+        looperFileFinish(j, false);
+        return;
+      }
+      if (j.op == LOOP_FILE_SAVE) looperFileSaveStep(j);
+      else looperFileExportStep(j);
+      break;
+    case LOOP_FILE_LOAD:
+      looperFileLoadStep(j);
+      break;
+    default:
+      break;
+  }
+}
+
+#endif // LOOPER_FILE_V2_H
@@ -2,15 +2,105 @@
 #define LOOPER_V2_H
 
 //================================ LOOPER DEFINES ================================
-#define MAX_LOOP_EVENTS 256
 #define LOOP_TICKS_PER_BEAT 24    // Match MIDI clock (24 PPQN)
 #define LOOP_TICKS_PER_BAR (LOOP_TICKS_PER_BEAT * 4)  // 96 ticks per bar (4/4 time)
 
+// Tracks: each has its own length, output channel, mute/solo and record
+// state, and its own playhead. All playheads advance from looperClockTick;
+// a fixed-length track's playhead is the transport position modulo its
+// length, so 1/2/4/8 bar tracks stay aligned on bar lines. Only one track is
+// armed (recording or overdubbing) at a time - the selected one.
+#define LOOP_TRACKS 4
+
+// Event storage: a fixed pool of packed records shared by all tracks, chained
+// per track and tick. Each (track, tick) has a bucket (head/tail index into
+// the pool), so recording appends in O(1) and playback walks exactly the
+// records due at a tick - at most LOOP_TRACKS bucket walks per tick.
+// Records within a tick stay in recording order.
+// RAM: LOOP_POOL_SIZE * 8 + LOOP_TRACKS * LOOP_MAX_TICKS * 4 bytes (~56 KB)
+#define LOOP_POOL_SIZE 4096       // Events across all tracks
+#define LOOP_MAX_BARS 16
+#define LOOP_MAX_TICKS (LOOP_TICKS_PER_BAR * LOOP_MAX_BARS)  // 1536 ticks
+#define LOOP_NONE 0xFFFF          // End of a bucket / free list
+
 // Loop length options
 #define LOOP_LENGTH_1_BAR   0
 #define LOOP_LENGTH_2_BARS  1
 #define LOOP_LENGTH_4_BARS  2   // Default
-#define LOOP_LENGTH_FREE    3
+#define LOOP_LENGTH_FREE    3   // Set by the first recording, up to LOOP_MAX_BARS
+#define LOOP_LENGTH_8_BARS  4
+#define LOOP_LENGTH_16_BARS 5
+#define NUM_LOOP_LENGTHS    6
+
+// Sub-tick timing: a recorded event also keeps how far between two clock
+// ticks it happened, in 1/LOOP_SUBTICKS of a tick (960 PPQN in total),
+// measured against the time and period of the last tick. Playback sends
+// events with an offset through the scheduler at the interpolated time;
+// on-tick events go out directly as before.
+// Quantize-on-record moves note-ons to the grid (note-offs follow their
+// note-on so lengths are kept). An event moved ahead of the playhead while
+// overdubbing is flagged to sit out one pass, so it isn't heard twice.
+#define LOOP_SUBTICKS          40      // Per 24 PPQN tick -> 960 PPQN
+#define LOOP_SUB_MASK          0x3F
+#define LOOP_SUB_SKIP          0x80    // Recorded ahead of the playhead - skip its next pass
+
+#define LOOP_QUANTIZE_OFF      0       // Full resolution
+#define LOOP_QUANTIZE_TICK     1       // 24 PPQN clock
+#define LOOP_QUANTIZE_16TH     2
+#define LOOP_QUANTIZE_8TH      3
+#define NUM_LOOP_QUANTIZE      4
+
+// Layers: a track's first pass is layer 0 and each overdub (armed to
+// disarmed) adds the next one. Records are tagged with their layer, and since
+// a layer is finished before the next starts, every bucket holds its layers
+// in order - later layers are always a suffix of the chain. Undo/redo just
+// moves the track's visible layer count; playback, the piano roll and file
+// jobs stop walking a bucket at the first hidden record. Undone layers are
+// freed when a new overdub starts (it replaces them). At LOOP_MAX_LAYERS the
+// two oldest layers are merged to make room.
+#define LOOP_MAX_LAYERS        8
+
+// Other channel messages: pitch bend, CC, program change and pressure are
+// recorded too - the status nibble goes in LoopEvent.kind, the data bytes
+// where a note keeps its note and velocity. Continuous streams (pitch bend,
+// pressure, value CCs) are thinned as they're recorded, per stream:
+//   - a value equal to the previous one is dropped
+//   - within LOOP_THIN_SUBTICKS of the last stored value only the newest is
+//     held back; it is stored anyway where the stream turns round (a peak)
+//   - a jump is stored at once
+//   - the held value is stored when the stream goes quiet for
+//     LOOP_THIN_IDLE_MS, or recording stops, so every sweep keeps its end
+// A pitch-bend glide comes out at about one value per clock tick rather
+// than one per loop() pass.
+#define LOOP_KIND_NOTE         0       // Note on/off; other kinds are 0xA-0xE (status >> 4)
+
+#define LOOP_THIN_STREAMS      8       // Streams followed at once (oldest gives way)
+#define LOOP_THIN_SUBTICKS     LOOP_SUBTICKS
+#define LOOP_THIN_IDLE_MS      40
+#define LOOP_THIN_JUMP         16      // 7-bit steps (pitch bend: x128) stored at once
+
+// Controllers a track's playback can leave away from rest on the receiver.
+// Silencing the track puts them back (centre / 0 / off), like the note-offs.
+#define LOOP_REST_BEND         0       // Pitch bend (rest: centre)
+#define LOOP_REST_PRESSURE     1       // Channel pressure (rest: 0)
+#define LOOP_REST_MOD          2       // CC 1 mod wheel (rest: 0)
+#define LOOP_REST_SUSTAIN      3       // CC 64 sustain (rest: off)
+#define LOOP_REST_KINDS        4
+
+// Track output routing
+#define LOOP_CHANNEL_AS_RECORDED 0xFF  // Play each note on the channel it was recorded on
+
+// Piano-roll cache: the displayed track's note-on dots, pre-rendered in the
+// SSD1306 page layout. Recording plots each new note-on into it as the event
+// is stored; it is only redrawn from the buckets when the displayed track,
+// its span or the store's generation (something was freed) changes. A frame
+// ORs it into the framebuffer and adds the playhead and newest-note pulse.
+// Dots: x = 4..124 across the span, y = 14..47 from the note (3 octaves).
+#define LOOP_ROLL_X0       4
+#define LOOP_ROLL_WIDTH    120
+#define LOOP_ROLL_PAGE0    1       // Rows 8-55 hold every dot (y +/- 1)
+#define LOOP_ROLL_PAGES    6
+#define LOOP_ROLL_NO_TRACK 0xFF
 
 // Looper LED color
 #define COLOR_LOOPER_REC    0xFF0000  // Red for recording
@@ -20,12 +110,18 @@
 
 //================================ DATA STRUCTURES ================================
 
-// Single recorded MIDI event - 6 bytes each
+// Single recorded MIDI event - 8 bytes each, its tick is the bucket it's in
 // Bit 7 of velocityAndFlags: 0=noteOn, 1=noteOff
+// channelAndPad: where the note came from, so playback keeps its routing
+// Other messages: note/velocityAndFlags hold data1/data2 (bit 7 clear)
 struct LoopEvent {
-  uint32_t timestamp;       // Tick position (0 to loopLengthTicks-1)
-  uint8_t note;             // MIDI note (0-127)
-  uint8_t velocityAndFlags; // bits 0-6: velocity, bit 7: isNoteOff
+  uint16_t next;            // Next record in the same tick (or free list), LOOP_NONE = last
+  uint8_t note;             // MIDI note (0-127), or data1
+  uint8_t velocityAndFlags; // bits 0-6: velocity or data2, bit 7: isNoteOff
+  uint8_t channelAndPad;    // bits 0-3: output channel, bits 4-7: pad (0xF = none)
+  uint8_t subTick;          // bits 0-5: offset after the tick (0..LOOP_SUBTICKS-1), bit 7: skip next pass
+  uint8_t layer;            // Recording pass, 0..LOOP_MAX_LAYERS-1
+  uint8_t kind;             // LOOP_KIND_NOTE, or the status nibble of another channel message
 };
 
 // Helper macros for LoopEvent
@@ -33,25 +129,112 @@ struct LoopEvent {
 #define LOOP_EVENT_VELOCITY(e) ((e).velocityAndFlags & 0x7F)
 #define LOOP_EVENT_SET_ON(e, vel) ((e).velocityAndFlags = (vel) & 0x7F)
 #define LOOP_EVENT_SET_OFF(e, vel) ((e).velocityAndFlags = 0x80 | ((vel) & 0x7F))
+#define LOOP_EVENT_CHANNEL(e) ((e).channelAndPad & 0x0F)
+#define LOOP_EVENT_PAD(e) (((e).channelAndPad >> 4) == 0x0F ? -1 : ((e).channelAndPad >> 4))
+#define LOOP_EVENT_SET_SOURCE(e, ch, pad) ((e).channelAndPad = ((ch) & 0x0F) | (((pad) < 0 ? 0x0F : (pad)) << 4))
+#define LOOP_EVENT_SUB(e) ((e).subTick & LOOP_SUB_MASK)
+#define LOOP_EVENT_IS_NOTE(e) ((e).kind == LOOP_KIND_NOTE)
+#define LOOP_EVENT_IS_NOTE_ON(e) (LOOP_EVENT_IS_NOTE(e) && !LOOP_EVENT_IS_OFF(e))
+#define LOOP_EVENT_DATA2(e) ((e).velocityAndFlags & 0x7F)
 
-// Looper state structure
-struct LooperState {
+// A controller stream being thinned (pitch bend, pressure or one CC number)
+struct LoopThinStream {
+  bool active = false;
+  uint8_t track;
+  uint8_t status;                // As sent (kind | channel)
+  uint8_t key;                   // CC number / poly pressure note, 0 otherwise
+  int16_t value;                 // Newest value seen
+  int8_t direction;              // Sign of the newest change, 0 = none yet
+  int32_t storedPos;             // Record position (sub-ticks) of the last stored value
+  bool held;                     // The newest value wasn't stored yet
+  uint8_t heldData1, heldData2;
+  int32_t heldPos;
+  unsigned long lastTime;        // millis() of the newest value
+};
+
+// Cached piano roll (also copied into the UI snapshot)
+struct LooperView {
+  uint8_t pages[LOOP_ROLL_PAGES][128];       // Unrotated page layout from LOOP_ROLL_PAGE0
+  uint32_t spanTicks = LOOP_TICKS_PER_BAR;   // Ticks across the display
+  uint8_t track = LOOP_ROLL_NO_TRACK;        // Track drawn
+  uint32_t generation = 0;                   // looper.storeGeneration it was drawn at
+};
+
+// Event pool + per-track, per-tick buckets
+struct LoopStore {
+  LoopEvent pool[LOOP_POOL_SIZE];
+  uint16_t freeHead = LOOP_NONE;
+  uint16_t freeCount = 0;
+  uint16_t bucketHead[LOOP_TRACKS][LOOP_MAX_TICKS];
+  uint16_t bucketTail[LOOP_TRACKS][LOOP_MAX_TICKS];
+  bool initialized = false;
+
+  // Quantize-on-record: how far each channel/note's note-on was moved
+  // (sub-ticks), applied to its note-off
+  int16_t quantizeShift[16][128];
+
+  LooperView roll;               // Piano roll of the displayed track
+
+  LoopThinStream thin[LOOP_THIN_STREAMS];
+
+  // Controllers each track's playback moved away from rest (bit per channel)
+  uint16_t awayFromRest[LOOP_TRACKS][LOOP_REST_KINDS];
+};
+
+// One looper track
+struct LoopTrack {
   // State flags
-  bool recording = false;        // Currently recording (first pass)
-  bool overdubbing = false;      // Overdub mode (record while playing)
-  bool playing = false;          // Playback active
-  bool hasContent = false;       // Loop has recorded content
+  bool recording = false;        // Recording its first pass
+  bool overdubbing = false;      // Recording on top of its content
+  bool hasContent = false;       // Has recorded content
 
   // Timing
-  uint8_t loopLengthBars = LOOP_LENGTH_1_BAR;  // Default: 1 bar
-  uint32_t loopLengthTicks = LOOP_TICKS_PER_BAR;  // 96 ticks
-  uint32_t currentTick = 0;      // Current position (0 to loopLengthTicks-1)
-  uint32_t recordStartTick = 0;  // For FREE mode: when recording started
+  uint8_t lengthBars = LOOP_LENGTH_1_BAR;
+  uint32_t lengthTicks = LOOP_TICKS_PER_BAR;  // 0 while a FREE track records its first pass
+  uint32_t currentTick = 0;      // Next tick to play (0 to lengthTicks-1)
+  uint32_t lastTick = 0;         // Tick most recently reached - where new events are recorded
+  uint32_t recordTicks = 0;      // Ticks since the first pass started
+
+  // Output
+  uint8_t channel = LOOP_CHANNEL_AS_RECORDED;  // 0-15 overrides the recorded channel
+  bool muted = false;
+  bool soloed = false;
+
+  // Layers
+  uint8_t layerCount = 0;        // Layers recorded, including undone ones
+  uint8_t visibleLayers = 0;     // Layers [0, visibleLayers) play - the rest wait for a redo
+  uint16_t layerEvents[LOOP_MAX_LAYERS] = {};
+  uint16_t layerNoteOns[LOOP_MAX_LAYERS] = {};
+
+  // Event counts (records live in the LoopStore)
+  uint16_t eventCount = 0;       // All records, including undone layers
+  uint16_t noteOnCount = 0;      // Note-ons in visible layers
+};
+
+// Looper state structure (flags and timing - small enough for the UI snapshot)
+struct LooperState {
+  LoopTrack tracks[LOOP_TRACKS];
+  uint8_t selectedTrack = 0;     // Track the record/clear buttons act on
+  uint32_t transportTick = 0;    // Ticks since the looper started playing
+  uint32_t lastTickUs = 0;       // micros() of the last clock tick
+  uint32_t tickPeriodUs = 0;     // Measured clock period (0 = unknown, record on the tick)
+  bool inputTimed = false;       // A key event or fired event is being handled - record at its time
+  uint32_t inputTimeUs = 0;      // micros() of that key edge / scheduled due time
+  uint8_t quantize = LOOP_QUANTIZE_OFF;  // LOOP_QUANTIZE_*
 
-  // Event storage
-  LoopEvent events[MAX_LOOP_EVENTS];
-  uint16_t eventCount = 0;       // Number of recorded events
-  uint16_t playbackIndex = 0;    // Next event to play
+  // Summary of all tracks (kept by looperUpdateFlags)
+  bool recording = false;        // A track is recording its first pass
+  bool overdubbing = false;      // A track is overdubbing
+  bool playing = false;          // Transport running
+  bool hasContent = false;       // Any track has recorded content
+
+  uint16_t droppedEvents = 0;    // Recording refused because the pool was full
+  uint32_t storeGeneration = 0;  // Bumped whenever records are freed or hidden (file jobs check it)
+
+  // Loop file (looperFileV2.h)
+  bool loading = false;          // A saved loop is being read in - looper controls wait
+  uint8_t fileStatus = 0;        // LOOP_FILE_STATUS_*
+  unsigned long fileStatusTime = 0;
 
   // For LED feedback during playback
   int8_t lastPlayedPad = -1;     // Pad index of last played note (-1 if none)
@@ -62,212 +245,913 @@ struct LooperState {
 
   // Animation for newly recorded notes
   unsigned long lastRecordTime = 0;  // When last note was recorded
+  uint8_t lastRecordTrack = 0;       // Track of last recorded note
   uint32_t lastRecordTick = 0;       // Tick position of last recorded note
   uint8_t lastRecordNote = 0;        // Note value of last recorded note
 };
 
 // Global looper state (declared in main sketch)
 extern LooperState looper;
+extern LoopStore loopStore;
+extern VoiceTable voices;
+extern Scheduler scheduler;
 
-// External references - functions and display object
+// External references - display object
 extern Adafruit_SSD1306 display;
-extern void sendNoteOn(int note, int velocity, int channel);
-extern void sendNoteOff(int note, int velocity, int channel);
-extern void killAllNotes();
-extern int getLooperOutputChannel();  // Returns settings.midiOutputAChannel
+
+//================================ PIANO ROLL ================================
+
+inline uint8_t looperRollX(uint32_t tick, uint32_t spanTicks) {
+  return constrain(LOOP_ROLL_X0 + (int)((tick * LOOP_ROLL_WIDTH) / spanTicks), LOOP_ROLL_X0, LOOP_ROLL_X0 + LOOP_ROLL_WIDTH);
+}
+
+// Note modulo 36 fits ~3 octaves, inverted so high notes are at the top
+inline uint8_t looperRollY(uint8_t note) {
+  return 47 - ((note % 36) * 33) / 35;
+}
+
+inline void looperRollPixel(LooperView& v, uint8_t x, uint8_t y) {
+  v.pages[(y >> 3) - LOOP_ROLL_PAGE0][x] |= 1 << (y & 7);
+}
+
+// One dot - the same plus shape fillCircle(x, y, 1) draws
+void looperRollPlot(LooperView& v, uint8_t x, uint8_t y) {
+  looperRollPixel(v, x, y - 1);
+  looperRollPixel(v, x, y);
+  looperRollPixel(v, x, y + 1);
+  looperRollPixel(v, x - 1, y);
+  looperRollPixel(v, x + 1, y);
+}
+
+// Ticks across the display: the loop, or while a FREE track records its
+// first pass, the bars recorded so far (whole bars, so the roll is redrawn
+// once a bar rather than every tick)
+uint32_t looperRollSpan(const LoopTrack& tr) {
+  if (tr.lengthTicks > 0) return tr.lengthTicks;
+  uint32_t span = (tr.currentTick / LOOP_TICKS_PER_BAR + 1) * LOOP_TICKS_PER_BAR;
+  return (span < LOOP_MAX_TICKS) ? span : LOOP_MAX_TICKS;
+}
+
+// Redraw the roll from a track's buckets
+void looperRollRebuild(LooperView& v, uint8_t track, uint32_t spanTicks) {
+  memset(v.pages, 0, sizeof(v.pages));
+  v.track = track;
+  v.spanTicks = spanTicks;
+  v.generation = looper.storeGeneration;
+
+  uint8_t visible = looper.tracks[track].visibleLayers;
+  uint32_t lastBucket = (spanTicks < LOOP_MAX_TICKS) ? spanTicks : LOOP_MAX_TICKS;
+  for (uint32_t t = 0; t < lastBucket; t++) {
+    for (uint16_t i = loopStore.bucketHead[track][t]; i != LOOP_NONE; i = loopStore.pool[i].next) {
+      const LoopEvent& evt = loopStore.pool[i];
+      if (evt.layer >= visible) break;               // Undone layers
+      if (!LOOP_EVENT_IS_NOTE_ON(evt)) continue;     // Only show note-ons
+      looperRollPlot(v, looperRollX(t, spanTicks), looperRollY(evt.note));
+    }
+  }
+}
+
+//================================ STORE ================================
+
+void looperResetLayers(LoopTrack& tr) {
+  tr.layerCount = 0;
+  tr.visibleLayers = 0;
+  memset(tr.layerEvents, 0, sizeof(tr.layerEvents));
+  memset(tr.layerNoteOns, 0, sizeof(tr.layerNoteOns));
+  tr.eventCount = 0;
+  tr.noteOnCount = 0;
+}
+
+// Empty every bucket and put the whole pool on the free list
+void looperStoreClear() {
+  for (uint16_t i = 0; i < LOOP_POOL_SIZE; i++) {
+    loopStore.pool[i].next = (i + 1 < LOOP_POOL_SIZE) ? i + 1 : LOOP_NONE;
+  }
+  loopStore.freeHead = 0;
+  loopStore.freeCount = LOOP_POOL_SIZE;
+  for (uint8_t tr = 0; tr < LOOP_TRACKS; tr++) {
+    for (uint16_t t = 0; t < LOOP_MAX_TICKS; t++) {
+      loopStore.bucketHead[tr][t] = LOOP_NONE;
+      loopStore.bucketTail[tr][t] = LOOP_NONE;
+    }
+    looperResetLayers(looper.tracks[tr]);
+  }
+  for (uint8_t i = 0; i < LOOP_THIN_STREAMS; i++) {
+    loopStore.thin[i].active = false;
+  }
+  loopStore.initialized = true;
+  looper.storeGeneration++;
+}
+
+// Return one track's records to the free list
+void looperStoreClearTrack(uint8_t track) {
+  if (!loopStore.initialized) {
+    looperStoreClear();
+    return;
+  }
+  for (uint16_t t = 0; t < LOOP_MAX_TICKS; t++) {
+    uint16_t head = loopStore.bucketHead[track][t];
+    if (head == LOOP_NONE) continue;
+    // Splice the whole bucket onto the free list
+    uint16_t tail = loopStore.bucketTail[track][t];
+    loopStore.pool[tail].next = loopStore.freeHead;
+    loopStore.freeHead = head;
+    loopStore.bucketHead[track][t] = LOOP_NONE;
+    loopStore.bucketTail[track][t] = LOOP_NONE;
+  }
+  loopStore.freeCount += looper.tracks[track].eventCount;
+  looper.storeGeneration++;
+  looperResetLayers(looper.tracks[track]);
+  for (uint8_t i = 0; i < LOOP_THIN_STREAMS; i++) {
+    if (loopStore.thin[i].track == track) loopStore.thin[i].active = false;
+  }
+}
+
+// Append a record to a track's bucket for a tick - evt.layer must be the
+// track's newest layer. False if the pool is full.
+bool looperStoreAppend(uint8_t track, uint32_t tick, const LoopEvent& evt) {
+  if (!loopStore.initialized) looperStoreClear();
+  if (tick >= LOOP_MAX_TICKS || evt.layer >= LOOP_MAX_LAYERS || loopStore.freeHead == LOOP_NONE) {
+    looper.droppedEvents++;
+    return false;
+  }
+
+  uint16_t i = loopStore.freeHead;
+  loopStore.freeHead = loopStore.pool[i].next;
+  loopStore.freeCount--;
+  loopStore.pool[i] = evt;
+  loopStore.pool[i].next = LOOP_NONE;
+
+  uint16_t& tail = loopStore.bucketTail[track][tick];
+  if (tail == LOOP_NONE) {
+    loopStore.bucketHead[track][tick] = i;
+  } else {
+    loopStore.pool[tail].next = i;
+  }
+  tail = i;
+
+  LoopTrack& tr = looper.tracks[track];
+  tr.eventCount++;
+  tr.layerEvents[evt.layer]++;
+  if (LOOP_EVENT_IS_NOTE_ON(evt)) {
+    tr.noteOnCount++;
+    tr.layerNoteOns[evt.layer]++;
+
+    // Add the dot if the roll is showing this track and is otherwise current
+    LooperView& roll = loopStore.roll;
+    if (roll.track == track && roll.generation == looper.storeGeneration && tick < roll.spanTicks) {
+      looperRollPlot(roll, looperRollX(tick, roll.spanTicks), looperRollY(evt.note));
+    }
+  }
+  return true;
+}
+
+// Free a track's undone layers: cut each bucket at its first hidden record
+// and splice the rest onto the free list
+void looperStoreDropHidden(uint8_t track) {
+  LoopTrack& tr = looper.tracks[track];
+  if (tr.visibleLayers >= tr.layerCount) return;
+
+  for (uint16_t t = 0; t < LOOP_MAX_TICKS; t++) {
+    uint16_t prev = LOOP_NONE;
+    uint16_t i = loopStore.bucketHead[track][t];
+    while (i != LOOP_NONE && loopStore.pool[i].layer < tr.visibleLayers) {
+      prev = i;
+      i = loopStore.pool[i].next;
+    }
+    if (i == LOOP_NONE) continue;
+
+    loopStore.pool[loopStore.bucketTail[track][t]].next = loopStore.freeHead;
+    loopStore.freeHead = i;
+    if (prev == LOOP_NONE) {
+      loopStore.bucketHead[track][t] = LOOP_NONE;
+    } else {
+      loopStore.pool[prev].next = LOOP_NONE;
+    }
+    loopStore.bucketTail[track][t] = prev;
+  }
+
+  for (uint8_t l = tr.visibleLayers; l < tr.layerCount; l++) {
+    loopStore.freeCount += tr.layerEvents[l];
+    tr.eventCount -= tr.layerEvents[l];
+    tr.layerEvents[l] = 0;
+    tr.layerNoteOns[l] = 0;
+  }
+  tr.layerCount = tr.visibleLayers;
+  looper.storeGeneration++;
+}
+
+// Merge layer 1 into layer 0 and renumber the rest down (all layers visible)
+void looperStoreMergeOldest(uint8_t track) {
+  LoopTrack& tr = looper.tracks[track];
+  for (uint16_t t = 0; t < LOOP_MAX_TICKS; t++) {
+    for (uint16_t i = loopStore.bucketHead[track][t]; i != LOOP_NONE; i = loopStore.pool[i].next) {
+      if (loopStore.pool[i].layer > 0) loopStore.pool[i].layer--;
+    }
+  }
+  tr.layerEvents[0] += tr.layerEvents[1];
+  tr.layerNoteOns[0] += tr.layerNoteOns[1];
+  for (uint8_t l = 1; l + 1 < tr.layerCount; l++) {
+    tr.layerEvents[l] = tr.layerEvents[l + 1];
+    tr.layerNoteOns[l] = tr.layerNoteOns[l + 1];
+  }
+  tr.layerCount--;
+  tr.layerEvents[tr.layerCount] = 0;
+  tr.layerNoteOns[tr.layerCount] = 0;
+  tr.visibleLayers = tr.layerCount;
+}
+
+// Start a new top layer for recording into - replaces any undone layers
+void looperStoreBeginLayer(uint8_t track) {
+  LoopTrack& tr = looper.tracks[track];
+  looperStoreDropHidden(track);
+  if (tr.layerCount >= LOOP_MAX_LAYERS) looperStoreMergeOldest(track);
+  tr.layerCount++;
+  tr.visibleLayers = tr.layerCount;
+}
+
+// An overdub ended: forget its layer if nothing was recorded
+void looperStoreEndLayer(uint8_t track) {
+  LoopTrack& tr = looper.tracks[track];
+  if (tr.layerCount > 1 && tr.visibleLayers == tr.layerCount && tr.layerEvents[tr.layerCount - 1] == 0) {
+    tr.layerCount--;
+    tr.visibleLayers = tr.layerCount;
+  }
+}
+
+//================================ TRACK HELPERS ================================
+
+// Voice owner for a track's playback notes
+inline uint8_t looperVoiceOwner(uint8_t track) {
+  return VOICE_OWNER_LOOPER + track;
+}
+
+// Scheduler owner for a track's between-tick playback
+inline uint8_t looperSchedOwner(uint8_t track) {
+  return SCHED_OWNER_LOOPER + track;
+}
+
+inline bool looperIsSchedOwner(uint8_t owner) {
+  return owner >= SCHED_OWNER_LOOPER && owner < SCHED_OWNER_LOOPER + LOOP_TRACKS;
+}
+
+// Note which controllers playback leaves away from rest
+void looperTrackControl(uint8_t track, uint8_t status, uint8_t data1, uint8_t data2) {
+  int kind;
+  bool atRest;
+  switch (status & 0xF0) {
+    case 0xE0: kind = LOOP_REST_BEND;     atRest = data1 == 0 && data2 == 64; break;
+    case 0xD0: kind = LOOP_REST_PRESSURE; atRest = data1 == 0;                break;
+    case 0xB0:
+      if (data1 == 1) {
+        kind = LOOP_REST_MOD;
+        atRest = data2 == 0;
+      } else if (data1 == 64) {
+        kind = LOOP_REST_SUSTAIN;
+        atRest = data2 < 64;
+      } else {
+        return;
+      }
+      break;
+    default:
+      return;
+  }
+  uint16_t& away = loopStore.awayFromRest[track][kind];
+  uint16_t bit = 1 << (status & 0x0F);
+  away = atRest ? (away & ~bit) : (away | bit);
+}
+
+// Put back the controllers a track's playback moved (after its note-offs,
+// so releasing the sustain doesn't let them ring on)
+void looperRestTrackControls(uint8_t track) {
+  uint16_t* away = loopStore.awayFromRest[track];
+  for (uint8_t ch = 0; ch < 16; ch++) {
+    uint16_t bit = 1 << ch;
+    if (away[LOOP_REST_SUSTAIN] & bit)  midiOutSend(0xB0 | ch, 64, 0);
+    if (away[LOOP_REST_MOD] & bit)      midiOutSend(0xB0 | ch, 1, 0);
+    if (away[LOOP_REST_PRESSURE] & bit) midiOutSend(0xD0 | ch, 0, 0);
+    if (away[LOOP_REST_BEND] & bit)     midiOutSend(0xE0 | ch, 0, 64);
+  }
+  memset(away, 0, sizeof(loopStore.awayFromRest[track]));
+}
+
+// Stop everything a track is playing or about to play
+void looperSilenceTrack(uint8_t track) {
+  schedulerRelease(scheduler, looperSchedOwner(track));
+  voicesStopOwner(voices, looperVoiceOwner(track));
+  looperRestTrackControls(track);
+}
+
+uint32_t looperLengthTicksFor(uint8_t lengthBars) {
+  switch (lengthBars) {
+    case LOOP_LENGTH_2_BARS:  return LOOP_TICKS_PER_BAR * 2;   // 192 ticks
+    case LOOP_LENGTH_4_BARS:  return LOOP_TICKS_PER_BAR * 4;   // 384 ticks
+    case LOOP_LENGTH_8_BARS:  return LOOP_TICKS_PER_BAR * 8;   // 768 ticks
+    case LOOP_LENGTH_16_BARS: return LOOP_TICKS_PER_BAR * 16;  // 1536 ticks
+    case LOOP_LENGTH_FREE:    return 0;                        // Will be set when recording stops
+    default:                  return LOOP_TICKS_PER_BAR;       // 96 ticks
+  }
+}
+
+// Track being recorded into, -1 if none
+int looperArmedTrack() {
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    if (looper.tracks[t].recording || looper.tracks[t].overdubbing) return t;
+  }
+  return -1;
+}
+
+bool looperAnySolo(const LooperState& lp) {
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    if (lp.tracks[t].soloed) return true;
+  }
+  return false;
+}
+
+// Track is heard: not muted, and soloed if anything is
+bool looperTrackAudible(const LooperState& lp, uint8_t track) {
+  const LoopTrack& tr = lp.tracks[track];
+  if (tr.muted) return false;
+  return tr.soloed || !looperAnySolo(lp);
+}
+
+// True if no audible track has anything to play in the next us
+// microseconds (an unknown tick period counts as the slowest clock)
+bool looperQuietFor(uint32_t us) {
+  if (!looper.playing) return true;
+  uint32_t period = looper.tickPeriodUs ? looper.tickPeriodUs : CLOCK_MAX_PERIOD_US;
+  uint32_t ticks = us / period + 1;
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    const LoopTrack& tr = looper.tracks[t];
+    if (!tr.hasContent || tr.lengthTicks == 0 || !looperTrackAudible(looper, t)) continue;
+    for (uint32_t k = 0; k < ticks && k < tr.lengthTicks; k++) {
+      uint32_t tick = (tr.currentTick + k) % tr.lengthTicks;
+      if (tick >= LOOP_MAX_TICKS) continue;
+      uint16_t i = loopStore.bucketHead[t][tick];
+      if (i != LOOP_NONE && loopStore.pool[i].layer < tr.visibleLayers) return false;
+    }
+  }
+  return true;
+}
+
+// Release the notes of tracks that can no longer be heard
+void looperReleaseSilencedTracks() {
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    if (!looperTrackAudible(looper, t)) looperSilenceTrack(t);
+  }
+}
+
+// Recompute the summary flags from the tracks
+void looperUpdateFlags() {
+  looper.recording = false;
+  looper.overdubbing = false;
+  looper.hasContent = false;
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    const LoopTrack& tr = looper.tracks[t];
+    looper.recording |= tr.recording;
+    looper.overdubbing |= tr.overdubbing;
+    looper.hasContent |= tr.hasContent;
+  }
+  if (!looper.hasContent && !looper.recording) {
+    looper.playing = false;
+  }
+}
+
+// Line a track's playhead up with the transport
+void looperAlignTrack(LoopTrack& tr) {
+  tr.currentTick = (tr.lengthTicks > 0) ? looper.transportTick % tr.lengthTicks : 0;
+  tr.lastTick = (tr.currentTick > 0) ? tr.currentTick - 1 : 0;
+}
 
 //================================ FUNCTION IMPLEMENTATIONS ================================
 
 // Initialize looper (call from setup)
 void initLooper() {
-  looper.recording = false;
-  looper.overdubbing = false;
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    looper.tracks[t] = LoopTrack();
+  }
+  looper.selectedTrack = 0;
+  looper.transportTick = 0;
   looper.playing = false;
-  looper.hasContent = false;
-  looper.eventCount = 0;
-  looper.currentTick = 0;
-  looper.playbackIndex = 0;
   looper.lastPlayedPad = -1;
-  looper.loopLengthBars = LOOP_LENGTH_1_BAR;
-  looper.loopLengthTicks = LOOP_TICKS_PER_BAR;
   looper.isPlayingBack = false;
+  looperStoreClear();
+  looperUpdateFlags();
 }
 
-// Calculate loop length in ticks based on bars setting
-void looperCalculateLoopLength() {
-  switch (looper.loopLengthBars) {
-    case LOOP_LENGTH_1_BAR:
-      looper.loopLengthTicks = LOOP_TICKS_PER_BAR;       // 96 ticks
-      break;
-    case LOOP_LENGTH_2_BARS:
-      looper.loopLengthTicks = LOOP_TICKS_PER_BAR * 2;   // 192 ticks
-      break;
-    case LOOP_LENGTH_4_BARS:
-      looper.loopLengthTicks = LOOP_TICKS_PER_BAR * 4;   // 384 ticks
-      break;
-    case LOOP_LENGTH_FREE:
-      looper.loopLengthTicks = 0;  // Will be set when recording stops
-      break;
+// Armed track if events should be recorded now, -1 if not
+int looperRecordTrack() {
+  if (!looper.recording && !looper.overdubbing) return -1;
+  if (looper.isPlayingBack) return -1;  // Don't re-record playback notes
+  return looperArmedTrack();
+}
+
+// Where an event recorded now lands, in sub-ticks: the tick already reached
+// (so a note overdubbed now plays on the next pass, not the next tick) plus
+// how far we are towards the next one. While a key event is handled "now"
+// is its debounced edge (for a scheduler event, its due time), so how long
+// loop() took to get to it doesn't move the note - that can put it up to a tick before the last one.
+int32_t looperRecordPosition(const LoopTrack& tr) {
+  int32_t sub = 0;
+  if (looper.tickPeriodUs > 0) {
+    int32_t period = looper.tickPeriodUs;
+    uint32_t at = looper.inputTimed ? looper.inputTimeUs : micros();
+    int32_t elapsed = constrain((int32_t)(at - looper.lastTickUs), -period, period - 1);
+    sub = elapsed * LOOP_SUBTICKS / period;
+  }
+  return (int32_t)tr.lastTick * LOOP_SUBTICKS + sub;
+}
+
+// Quantize grid in sub-ticks, 0 = off
+int32_t looperQuantizeGrid() {
+  switch (looper.quantize) {
+    case LOOP_QUANTIZE_TICK: return LOOP_SUBTICKS;
+    case LOOP_QUANTIZE_16TH: return LOOP_SUBTICKS * LOOP_TICKS_PER_BEAT / 4;
+    case LOOP_QUANTIZE_8TH:  return LOOP_SUBTICKS * LOOP_TICKS_PER_BEAT / 2;
+    default:                 return 0;
+  }
+}
+
+// Store evt at pos (sub-ticks, may be outside the loop after quantizing).
+// now is the unquantized position: an event moved onto a tick that hasn't
+// played yet this pass sits the pass out. Returns the tick it went to, -1 if
+// the pool was full.
+int32_t looperRecordAt(uint8_t track, int32_t pos, int32_t now, LoopEvent& evt) {
+  const LoopTrack& tr = looper.tracks[track];
+  bool ahead = pos > now && pos / LOOP_SUBTICKS != now / LOOP_SUBTICKS;
+
+  int32_t span = tr.lengthTicks * LOOP_SUBTICKS;  // 0 while FREE records its first pass
+  if (span > 0) {
+    pos %= span;
+    if (pos < 0) pos += span;
+  } else {
+    pos = constrain(pos, 0, LOOP_MAX_TICKS * LOOP_SUBTICKS - 1);
   }
+
+  evt.subTick = (pos % LOOP_SUBTICKS) | ((ahead && tr.hasContent) ? LOOP_SUB_SKIP : 0);
+  evt.layer = tr.layerCount - 1;
+  int32_t tick = pos / LOOP_SUBTICKS;
+  return looperStoreAppend(track, tick, evt) ? tick : -1;
 }
 
-// Record a note-on event
-void looperRecordNoteOn(uint8_t note, uint8_t velocity) {
-  if (looper.eventCount >= MAX_LOOP_EVENTS) return;
-  if (!looper.recording && !looper.overdubbing) return;
-  if (looper.isPlayingBack) return;  // Don't re-record playback notes
+// Record a note-on event (channel 0-15, pad -1 if not from a pad)
+void looperRecordNoteOn(uint8_t note, uint8_t velocity, uint8_t channel, int pad) {
+  int track = looperRecordTrack();
+  if (track < 0) return;
 
   LoopEvent evt;
-  evt.timestamp = looper.currentTick;
+  evt.kind = LOOP_KIND_NOTE;
   evt.note = note;
   LOOP_EVENT_SET_ON(evt, velocity);
+  LOOP_EVENT_SET_SOURCE(evt, channel, pad);
 
-  // Insert sorted by timestamp
-  int insertPos = looper.eventCount;
-  while (insertPos > 0 && looper.events[insertPos - 1].timestamp > evt.timestamp) {
-    looper.events[insertPos] = looper.events[insertPos - 1];
-    insertPos--;
+  int32_t now = looperRecordPosition(looper.tracks[track]);
+  int32_t pos = now;
+  int32_t grid = looperQuantizeGrid();
+  if (grid > 0) {
+    pos = ((now + grid / 2) / grid) * grid;
   }
-  looper.events[insertPos] = evt;
-  looper.eventCount++;
+  loopStore.quantizeShift[channel & 0x0F][note & 0x7F] = pos - now;
+
+  int32_t tick = looperRecordAt(track, pos, now, evt);
+  if (tick < 0) return;
 
   // Track for animation
   looper.lastRecordTime = millis();
-  looper.lastRecordTick = looper.currentTick;
+  looper.lastRecordTrack = track;
+  looper.lastRecordTick = tick;
   looper.lastRecordNote = note;
 }
 
-// Record a note-off event
-void looperRecordNoteOff(uint8_t note, uint8_t velocity) {
-  if (looper.eventCount >= MAX_LOOP_EVENTS) return;
-  if (!looper.recording && !looper.overdubbing) return;
-  if (looper.isPlayingBack) return;  // Don't re-record playback notes
+// Record a note-off event - moved as far as its note-on was
+void looperRecordNoteOff(uint8_t note, uint8_t velocity, uint8_t channel, int pad) {
+  int track = looperRecordTrack();
+  if (track < 0) return;
 
   LoopEvent evt;
-  evt.timestamp = looper.currentTick;
+  evt.kind = LOOP_KIND_NOTE;
   evt.note = note;
   LOOP_EVENT_SET_OFF(evt, velocity);
+  LOOP_EVENT_SET_SOURCE(evt, channel, pad);
+
+  int32_t now = looperRecordPosition(looper.tracks[track]);
+  looperRecordAt(track, now + loopStore.quantizeShift[channel & 0x0F][note & 0x7F], now, evt);
+}
+
+// Store a controller value where it was sent (never quantized)
+void looperStoreControl(uint8_t track, uint8_t status, uint8_t data1, uint8_t data2, int32_t pos) {
+  LoopEvent evt;
+  evt.kind = status >> 4;
+  evt.note = data1 & 0x7F;
+  evt.velocityAndFlags = data2 & 0x7F;
+  LOOP_EVENT_SET_SOURCE(evt, status & 0x0F, -1);
+  looperRecordAt(track, pos, pos, evt);
+}
 
-  // Insert sorted by timestamp
-  int insertPos = looper.eventCount;
-  while (insertPos > 0 && looper.events[insertPos - 1].timestamp > evt.timestamp) {
-    looper.events[insertPos] = looper.events[insertPos - 1];
-    insertPos--;
+// Pitch bend, pressure and value CCs; switches and parameter selects
+// (bank, RPN/NRPN, data entry, channel mode) keep every message
+bool looperThinnable(uint8_t status, uint8_t data1) {
+  switch (status & 0xF0) {
+    case 0xA0:
+    case 0xD0:
+    case 0xE0:
+      return true;
+    case 0xB0:
+      return !(data1 == 0 || data1 == 6 || data1 == 32 || data1 == 38 ||
+               (data1 >= 96 && data1 <= 101) || data1 >= 120);
+    default:
+      return false;
   }
-  looper.events[insertPos] = evt;
-  looper.eventCount++;
 }
 
-// Find which pad corresponds to a given MIDI note (for LED feedback)
-// This is implemented in the main sketch where pads[] is accessible
-extern int looperFindPadForNoteImpl(uint8_t note);
+// Store a stream's held value, if any
+void looperThinStoreHeld(LoopThinStream& st) {
+  if (!st.held) return;
+  looperStoreControl(st.track, st.status, st.heldData1, st.heldData2, st.heldPos);
+  st.storedPos = st.heldPos;
+  st.held = false;
+}
+
+// Stop following every stream - keepHeld stores their last values first
+void looperThinEnd(bool keepHeld) {
+  for (uint8_t i = 0; i < LOOP_THIN_STREAMS; i++) {
+    LoopThinStream& st = loopStore.thin[i];
+    if (!st.active) continue;
+    if (keepHeld) looperThinStoreHeld(st);
+    st.active = false;
+  }
+}
+
+// Record pitch bend, CC, program change or pressure (status includes the channel)
+void looperRecordControl(uint8_t status, uint8_t data1, uint8_t data2) {
+  int track = looperRecordTrack();
+  if (track < 0) return;
+  uint8_t command = status & 0xF0;
+  if (command < 0xA0 || command > 0xE0) return;
+
+  int32_t pos = looperRecordPosition(looper.tracks[track]);
+  if (!looperThinnable(status, data1)) {
+    looperStoreControl(track, status, data1, data2, pos);
+    return;
+  }
+
+  uint8_t key = (command == 0xA0 || command == 0xB0) ? data1 : 0;
+  int16_t value = (command == 0xE0) ? (data2 << 7) | data1 : (command == 0xD0) ? data1 : data2;
+  int16_t jump = (command == 0xE0) ? LOOP_THIN_JUMP << 7 : LOOP_THIN_JUMP;
+  unsigned long now = millis();
+
+  // This stream, or a free (else the oldest) slot for it
+  LoopThinStream* st = NULL;
+  LoopThinStream* spare = &loopStore.thin[0];
+  for (uint8_t i = 0; i < LOOP_THIN_STREAMS && !st; i++) {
+    LoopThinStream& s = loopStore.thin[i];
+    if (s.active && s.track == track && s.status == status && s.key == key) {
+      st = &s;
+    } else if (spare->active && (!s.active || (int32_t)(s.lastTime - spare->lastTime) < 0)) {
+      spare = &s;
+    }
+  }
+
+  if (!st) {
+    // New stream: its first value is always stored
+    if (spare->active) looperThinStoreHeld(*spare);
+    st = spare;
+    st->active = true;
+    st->track = track;
+    st->status = status;
+    st->key = key;
+    st->value = value;
+    st->direction = 0;
+    st->held = false;
+    st->lastTime = now;
+    st->storedPos = pos;
+    looperStoreControl(track, status, data1, data2, pos);
+    return;
+  }
+
+  st->lastTime = now;
+  if (value == st->value) return;  // Redundant
 
-int looperFindPadForNote(uint8_t note) {
-  return looperFindPadForNoteImpl(note);
+  int8_t direction = (value > st->value) ? 1 : -1;
+  bool turned = st->direction != 0 && direction != st->direction;
+  bool jumped = abs(value - st->value) >= jump;
+  st->value = value;
+  st->direction = direction;
+
+  if (turned) looperThinStoreHeld(*st);  // The held value is the peak
+
+  if (jumped || pos < st->storedPos || pos - st->storedPos >= LOOP_THIN_SUBTICKS) {
+    looperThinStoreHeld(*st);
+    looperStoreControl(track, status, data1, data2, pos);
+    st->storedPos = pos;
+    st->held = false;
+  } else {
+    st->held = true;
+    st->heldData1 = data1;
+    st->heldData2 = data2;
+    st->heldPos = pos;
+  }
 }
 
-// Toggle between record/overdub/play states (Shift+Oct-)
+// Stop overdubbing on every track (one armed track at a time)
+void looperDisarmOverdubs() {
+  looperThinEnd(true);
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    if (!looper.tracks[t].overdubbing) continue;
+    looper.tracks[t].overdubbing = false;
+    looperStoreEndLayer(t);
+  }
+}
+
+// Toggle between record/overdub/play states on the selected track (Shift+Oct-)
 void looperToggleRecordOverdub() {
-  if (!looper.hasContent && !looper.recording) {
-    // No content: Start fresh recording
-    looper.recording = true;
-    looper.overdubbing = false;
-    looper.playing = false;
-    looper.eventCount = 0;
-    looper.currentTick = 0;
-    looper.recordStartTick = 0;
-    looper.playbackIndex = 0;
-    looperCalculateLoopLength();
-  } else if (looper.recording) {
-    // Was recording first pass: Stop and start playback
-    looper.recording = false;
-    looper.hasContent = (looper.eventCount > 0);
-    if (looper.hasContent) {
-      // Finalize loop length for FREE mode
-      if (looper.loopLengthBars == LOOP_LENGTH_FREE) {
-        looper.loopLengthTicks = looper.currentTick > 0 ? looper.currentTick : LOOP_TICKS_PER_BAR;
-      }
+  if (looper.loading) return;
+  looperThinEnd(true);  // Controller values held back belong to this take
+  uint8_t sel = looper.selectedTrack;
+  LoopTrack& tr = looper.tracks[sel];
+
+  if (!tr.hasContent && !tr.recording) {
+    // Empty track: start a fresh recording, disarming any other track
+    looperDisarmOverdubs();
+    if (!looper.playing) {
+      looper.transportTick = 0;
       looper.playing = true;
-      looper.currentTick = 0;
-      looper.playbackIndex = 0;
     }
-  } else if (looper.overdubbing) {
+    looperStoreClearTrack(sel);
+    looperStoreBeginLayer(sel);
+    tr.recording = true;
+    tr.recordTicks = 0;
+    tr.lengthTicks = looperLengthTicksFor(tr.lengthBars);
+    looperAlignTrack(tr);
+  } else if (tr.recording) {
+    // Was recording first pass: stop and play it
+    tr.recording = false;
+    tr.hasContent = (tr.eventCount > 0);
+    if (tr.hasContent && tr.lengthTicks == 0) {
+      // Finalize loop length for FREE mode - it starts over from here
+      tr.lengthTicks = tr.currentTick > 0 ? tr.currentTick : LOOP_TICKS_PER_BAR;
+      tr.currentTick = 0;
+      tr.lastTick = 0;
+    }
+  } else if (tr.overdubbing) {
     // Was overdubbing: Stop overdub, continue playback
-    looper.overdubbing = false;
+    tr.overdubbing = false;
+    looperStoreEndLayer(sel);
   } else if (looper.playing) {
-    // Was playing: Start overdub
-    looper.overdubbing = true;
+    // Was playing: Start overdub (one armed track at a time)
+    looperDisarmOverdubs();
+    looperStoreBeginLayer(sel);
+    tr.overdubbing = true;
   } else {
-    // Has content but stopped: Start playback
+    // Has content but stopped: Start playback from the top
     looper.playing = true;
-    looper.currentTick = 0;
-    looper.playbackIndex = 0;
+    looper.transportTick = 0;
+    for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+      looper.tracks[t].currentTick = 0;
+      looper.tracks[t].lastTick = 0;
+    }
   }
+  looperUpdateFlags();
 }
 
-// Clear all loop content (Shift+Oct+)
+// Clear the selected track (Shift+Oct+). The transport stops once every
+// track is empty.
 void looperClear() {
-  looper.recording = false;
-  looper.overdubbing = false;
-  looper.playing = false;
-  looper.hasContent = false;
-  looper.eventCount = 0;
-  looper.currentTick = 0;
-  looper.playbackIndex = 0;
-  looper.lastPlayedPad = -1;
-  looper.isPlayingBack = false;
+  if (looper.loading) return;
+  uint8_t sel = looper.selectedTrack;
+  LoopTrack& tr = looper.tracks[sel];
+
+  looperSilenceTrack(sel);  // Stop any hanging notes
+  looperStoreClearTrack(sel);
+  tr.recording = false;
+  tr.overdubbing = false;
+  tr.hasContent = false;
+  tr.lengthTicks = looperLengthTicksFor(tr.lengthBars);
+  looperAlignTrack(tr);
+
+  looperUpdateFlags();
+  if (!looper.playing) {
+    looper.transportTick = 0;
+    looper.lastPlayedPad = -1;
+    looper.isPlayingBack = false;
+  }
+}
+
+// Hide the selected track's newest visible overdub (the first pass stays -
+// that's what clear is for). Stops an overdub in progress first.
+void looperUndo() {
+  if (looper.loading) return;
+  uint8_t sel = looper.selectedTrack;
+  LoopTrack& tr = looper.tracks[sel];
+  if (tr.recording) return;
+
+  if (tr.overdubbing) {
+    looperThinEnd(true);
+    tr.overdubbing = false;
+    looperStoreEndLayer(sel);
+  }
+  if (tr.visibleLayers > 1) {
+    looperSilenceTrack(sel);  // Notes of the hidden layer may be sounding
+    tr.visibleLayers--;
+    tr.noteOnCount -= tr.layerNoteOns[tr.visibleLayers];
+    looper.storeGeneration++;
+  }
+  looperUpdateFlags();
+}
+
+// Show the selected track's most recently undone layer again
+void looperRedo() {
+  if (looper.loading) return;
+  LoopTrack& tr = looper.tracks[looper.selectedTrack];
+  if (tr.recording || tr.overdubbing || tr.visibleLayers >= tr.layerCount) return;
+
+  tr.noteOnCount += tr.layerNoteOns[tr.visibleLayers];
+  tr.visibleLayers++;
+  looper.storeGeneration++;
+}
+
+// Select the track the record/clear buttons act on
+void looperSelectTrack(uint8_t track) {
+  if (track >= LOOP_TRACKS) return;
+  looper.selectedTrack = track;
+}
+
+// Change a track's length. Content beyond a shorter length is kept, and
+// plays again if the track is lengthened.
+void looperSetTrackLength(uint8_t track, uint8_t lengthBars) {
+  LoopTrack& tr = looper.tracks[track];
+  if (tr.recording || looper.loading) return;  // Length is fixed once the first pass started
+  tr.lengthBars = lengthBars;
+  uint32_t ticks = looperLengthTicksFor(lengthBars);
+  if (ticks == 0) {
+    // FREE: an empty track takes its length from the next recording,
+    // recorded content keeps the length it has
+    if (tr.hasContent) return;
+  }
+  looperSilenceTrack(track);
+  tr.lengthTicks = ticks;
+  looperAlignTrack(tr);
+}
 
-  killAllNotes();  // Stop any hanging notes
+// Route a track to one output channel, or LOOP_CHANNEL_AS_RECORDED
+void looperSetTrackChannel(uint8_t track, uint8_t channel) {
+  if (looper.tracks[track].channel == channel) return;
+  looperSilenceTrack(track);  // Note-offs go to the old channel
+  looper.tracks[track].channel = channel;
 }
 
-// Called on each MIDI clock tick (24 PPQN) - advances looper timing
-void looperClockTick() {
-  if (!looper.playing && !looper.recording && !looper.overdubbing) {
+void looperSetTrackMute(uint8_t track, bool muted) {
+  looper.tracks[track].muted = muted;
+  looperReleaseSilencedTracks();
+}
+
+void looperSetTrackSolo(uint8_t track, bool soloed) {
+  looper.tracks[track].soloed = soloed;
+  looperReleaseSilencedTracks();
+}
+
+// Send one event between ticks through the scheduler. The voice table is
+// updated now, as if it had already gone out, so an on-tick note-off or a
+// mute that comes before it fires still finds the note.
+void looperScheduleEvent(uint8_t track, const LoopEvent& evt, uint8_t channel, uint32_t due) {
+  uint8_t owner = looperVoiceOwner(track);
+  uint8_t schedOwner = looperSchedOwner(track);
+  bool sounding = voiceFind(voices, owner, evt.note, channel) >= 0;
+
+  if (LOOP_EVENT_IS_OFF(evt)) {
+    if (!sounding) return;
+    if (schedulerMidi(scheduler, due, SCHED_NOTE_OFF, schedOwner, 0x80 | channel, evt.note, 0)) {
+      voiceForget(voices, owner, evt.note, channel);
+    } else {
+      voiceStopNote(voices, owner, evt.note, channel);  // Queue full - now rather than never
+    }
     return;
   }
 
-  // Playback: trigger events at current tick
-  if (looper.playing || looper.overdubbing) {
-    looper.isPlayingBack = true;  // Prevent re-recording playback
-    // Play all events at current tick
-    while (looper.playbackIndex < looper.eventCount &&
-           looper.events[looper.playbackIndex].timestamp == looper.currentTick) {
-      LoopEvent& evt = looper.events[looper.playbackIndex];
+  if (sounding) {
+    // Retrigger: release the one still sounding first
+    voiceStopNote(voices, owner, evt.note, channel);
+  }
+  if (schedulerMidi(scheduler, due, SCHED_NOTE_ON, schedOwner, 0x90 | channel, evt.note, LOOP_EVENT_VELOCITY(evt))) {
+    voiceTrack(voices, owner, evt.note, channel);
+  } else {
+    voiceStart(voices, owner, VOICE_NO_SLOT, evt.note, LOOP_EVENT_VELOCITY(evt), channel);
+  }
+}
 
-      if (LOOP_EVENT_IS_OFF(evt)) {
-        sendNoteOff(evt.note, LOOP_EVENT_VELOCITY(evt), getLooperOutputChannel());
-      } else {
-        sendNoteOn(evt.note, LOOP_EVENT_VELOCITY(evt), getLooperOutputChannel());
-        // LED feedback - find which pad plays this note
-        looper.lastPlayedPad = looperFindPadForNote(evt.note);
-        looper.lastPlayedTime = millis();
+// Play the events in a track's bucket for its current tick (the tick itself
+// happened at tickUs)
+void looperPlayTrackTick(uint8_t track, uint32_t tickUs) {
+  const LoopTrack& tr = looper.tracks[track];
+  uint8_t owner = looperVoiceOwner(track);
+
+  for (uint16_t i = loopStore.bucketHead[track][tr.currentTick]; i != LOOP_NONE; i = loopStore.pool[i].next) {
+    LoopEvent& evt = loopStore.pool[i];
+    if (evt.layer >= tr.visibleLayers) break;  // Undone layers - the rest of the bucket
+    if (evt.subTick & LOOP_SUB_SKIP) {
+      evt.subTick &= ~LOOP_SUB_SKIP;  // Heard live when it was recorded
+      continue;
+    }
+    uint8_t channel = (tr.channel == LOOP_CHANNEL_AS_RECORDED) ? LOOP_EVENT_CHANNEL(evt) : tr.channel;
+    uint8_t sub = LOOP_EVENT_SUB(evt);
+    bool between = sub > 0 && looper.tickPeriodUs > 0;
+    uint32_t due = tickUs + sub * looper.tickPeriodUs / LOOP_SUBTICKS;
+
+    if (!LOOP_EVENT_IS_NOTE(evt)) {
+      // Controllers: no voices to keep, straight out (or at their time)
+      uint8_t status = (evt.kind << 4) | channel;
+      looperTrackControl(track, status, evt.note, LOOP_EVENT_DATA2(evt));
+      if (!between || !schedulerMidi(scheduler, due, SCHED_CC, looperSchedOwner(track), status, evt.note, LOOP_EVENT_DATA2(evt))) {
+        midiOutSend(status, evt.note, LOOP_EVENT_DATA2(evt));
       }
+      continue;
+    }
 
-      looper.playbackIndex++;
+    if (!LOOP_EVENT_IS_OFF(evt)) {
+      // LED feedback - the pad that recorded this note
+      looper.lastPlayedPad = LOOP_EVENT_PAD(evt);
+      looper.lastPlayedTime = millis();
     }
-    looper.isPlayingBack = false;
+
+    // Between ticks: at the interpolated time
+    if (between) {
+      looperScheduleEvent(track, evt, channel, due);
+      continue;
+    }
+
+    // Playback notes are looper voices so a clear or panic releases them
+    if (LOOP_EVENT_IS_OFF(evt)) {
+      voiceStopNote(voices, owner, evt.note, channel);
+    } else {
+      voiceStart(voices, owner, VOICE_NO_SLOT, evt.note, LOOP_EVENT_VELOCITY(evt), channel);
+    }
+  }
+}
+
+// Called on each MIDI clock tick (24 PPQN) - advances every track.
+// tickUs: when the tick happened; periodUs: current tick period (0 = unknown)
+void looperClockTick(uint32_t tickUs, uint32_t periodUs) {
+  looper.lastTickUs = tickUs;
+  looper.tickPeriodUs = (periodUs <= CLOCK_MAX_PERIOD_US) ? periodUs : 0;
+  if (!looper.playing) {
+    return;
   }
+  if (!loopStore.initialized) looperStoreClear();
 
-  // Advance tick counter
-  looper.currentTick++;
+  // Between-tick events from the last tick that haven't fired yet (clock
+  // jitter) go out first, so they stay in order with this tick's notes
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    schedulerPull(scheduler, looperSchedOwner(t), micros());
+  }
 
-  // Handle loop wrap or FREE mode extension
-  if (looper.loopLengthBars == LOOP_LENGTH_FREE && looper.recording) {
-    // FREE mode during first recording: no limit, just keep going
-    // (will be finalized when recording stops)
-  } else if (looper.loopLengthTicks > 0 && looper.currentTick >= looper.loopLengthTicks) {
-    // Fixed length or established FREE length: wrap around
-    looper.currentTick = 0;
-    looper.playbackIndex = 0;
+  // Playback: each audible track with content plays its bucket for this tick
+  looper.isPlayingBack = true;  // Prevent re-recording playback
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    const LoopTrack& tr = looper.tracks[t];
+    if (tr.hasContent && tr.currentTick < LOOP_MAX_TICKS && looperTrackAudible(looper, t)) {
+      looperPlayTrackTick(t, tickUs);
+    }
+  }
+  looper.isPlayingBack = false;
 
-    if (looper.recording) {
-      // First loop complete - switch to overdub+play mode
-      looper.recording = false;
-      looper.overdubbing = true;
-      looper.playing = true;
-      looper.hasContent = true;
+  looper.transportTick++;
+  bool flagsChanged = false;
+
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    LoopTrack& tr = looper.tracks[t];
+
+    // This tick is now the recording position
+    tr.lastTick = tr.currentTick;
+
+    // Advance tick counter
+    tr.currentTick++;
+
+    if (tr.recording) tr.recordTicks++;
+
+    // FREE mode during first recording: keep going until the store runs out
+    // of ticks, then close the loop there - the pass ends with it
+    if (tr.lengthTicks == 0) {
+      if (tr.currentTick < LOOP_MAX_TICKS) continue;
+      tr.lengthTicks = LOOP_MAX_TICKS;
+      tr.recordTicks = LOOP_MAX_TICKS;
+    }
+
+    if (tr.currentTick >= tr.lengthTicks) {
+      tr.currentTick = 0;  // Wrap around
+    }
+
+    // First pass complete (a track armed mid-loop records a whole length
+    // from where it started) - switch to overdub+play mode
+    if (tr.recording && tr.recordTicks >= tr.lengthTicks) {
+      looperThinEnd(true);  // Held controller values close the first pass
+      tr.recording = false;
+      looperStoreBeginLayer(t);  // The overdub is a layer of its own, for undo
+      tr.overdubbing = true;
+      tr.hasContent = true;
+      flagsChanged = true;
     }
   }
+  if (flagsChanged) looperUpdateFlags();
 }
 
 // Main update function (called from loop())
@@ -276,28 +1160,104 @@ void updateLooper() {
   if (looper.lastPlayedPad >= 0 && millis() - looper.lastPlayedTime > 100) {
     looper.lastPlayedPad = -1;
   }
+
+  // Controller streams that went quiet: store where they ended
+  for (uint8_t i = 0; i < LOOP_THIN_STREAMS; i++) {
+    LoopThinStream& st = loopStore.thin[i];
+    if (st.active && millis() - st.lastTime >= LOOP_THIN_IDLE_MS) {
+      looperThinStoreHeld(st);
+      st.active = false;
+    }
+  }
+}
+
+//================================ DISPLAY ================================
+
+// Bring the selected track's piano roll up to date and copy it out for
+// drawLooperScreen (core0, before publishing)
+void looperBuildView(LooperView& v) {
+  uint8_t track = looper.selectedTrack;
+  uint32_t span = looperRollSpan(looper.tracks[track]);
+  if (!loopStore.initialized) looperStoreClear();
+
+  LooperView& roll = loopStore.roll;
+  if (roll.track != track || roll.spanTicks != span || roll.generation != looper.storeGeneration) {
+    looperRollRebuild(roll, track, span);
+  }
+  v = roll;
+}
+
+// The roll is kept for rotation 0; rotation 2 (the panel mounted upside
+// down) mirrors both columns and pages, so each byte's bits flip too
+inline uint8_t looperRollFlip(uint8_t b) {
+  b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+  b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+  b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+  return b;
+}
+
+void looperRollBlit(Adafruit_SSD1306& d, const LooperView& v) {
+  uint8_t* buf = d.getBuffer();
+  bool flipped = (d.getRotation() == 2);
+  for (uint8_t p = 0; p < LOOP_ROLL_PAGES; p++) {
+    uint8_t page = LOOP_ROLL_PAGE0 + p;
+    for (uint8_t x = 0; x < SCREEN_WIDTH; x++) {
+      uint8_t b = v.pages[p][x];
+      if (!b) continue;
+      if (flipped) {
+        buf[(SCREEN_HEIGHT / 8 - 1 - page) * SCREEN_WIDTH + (SCREEN_WIDTH - 1 - x)] |= looperRollFlip(b);
+      } else {
+        buf[page * SCREEN_WIDTH + x] |= b;
+      }
+    }
+  }
 }
 
-// Draw looper display screen
-void drawLooperScreen() {
+// Draw looper display screen (from the core1 UI snapshot) - the selected
+// track's notes, with a strip of all tracks at the top
+void drawLooperScreen(const LooperState& lp, const LooperView& view) {
+  const LoopTrack& tr = lp.tracks[lp.selectedTrack];
+
   // Centered status text at top
   display.setTextSize(1);
   const char* statusText = "";
-  if (looper.recording) {
+  if (tr.recording) {
     if ((millis() / 250) % 2) statusText = "* REC *";
-  } else if (looper.overdubbing) {
+  } else if (tr.overdubbing) {
     if ((millis() / 300) % 2) statusText = "OVERDUB";
-  } else if (looper.playing) {
+  } else if (!tr.hasContent) {
+    statusText = "EMPTY";
+  } else if (!looperTrackAudible(lp, lp.selectedTrack)) {
+    statusText = "MUTED";
+  } else if (lp.playing) {
     statusText = "PLAYING";
-  } else if (looper.hasContent) {
+  } else {
     statusText = "STOPPED";
   }
   int textWidth = strlen(statusText) * 6;
   display.setCursor(64 - textWidth / 2, 0);
   display.print(statusText);
 
+  // Left: selected track number
+  display.setCursor(0, 0);
+  display.print("T");
+  display.print(lp.selectedTrack + 1);
+
+  // Right: one box per track - filled = has content and audible, underline = selected
+  for (uint8_t t = 0; t < LOOP_TRACKS; t++) {
+    const LoopTrack& other = lp.tracks[t];
+    int x = 128 - (LOOP_TRACKS - t) * 6;
+    if (other.recording || other.overdubbing || (other.hasContent && looperTrackAudible(lp, t))) {
+      display.fillRect(x, 1, 4, 5, WHITE);
+    } else {
+      display.drawRect(x, 1, 4, 5, WHITE);
+    }
+    if (t == lp.selectedTrack) display.drawFastHLine(x, 7, 4, WHITE);
+  }
+
   // Beat markers at top (4 beats for 1 bar)
-  int totalBeats = looper.loopLengthTicks / LOOP_TICKS_PER_BEAT;
+  int totalBeats = view.spanTicks / LOOP_TICKS_PER_BEAT;
+  if (totalBeats < 1) totalBeats = 1;
   for (int b = 0; b <= totalBeats; b++) {
     int x = 4 + (b * 120) / totalBeats;
     display.drawFastVLine(x, 10, 3, WHITE);
@@ -306,42 +1266,22 @@ void drawLooperScreen() {
   // Note visualization area: y=14 to y=48 (34 pixels height)
   // X = time (4 to 124), Y = pitch mapped to display
 
-  // Draw all recorded note-on events as dots
+  // Recorded note-ons from the cached roll
+  looperRollBlit(display, view);
+
+  // Animated expanding circle for the newest note
   unsigned long now = millis();
-  bool isNewNoteFlash = (now - looper.lastRecordTime) < 400;
-
-  for (int i = 0; i < looper.eventCount; i++) {
-    LoopEvent& evt = looper.events[i];
-    if (LOOP_EVENT_IS_OFF(evt)) continue;  // Only show note-ons
-
-    // X position based on timestamp
-    int x = 4 + ((evt.timestamp * 120) / looper.loopLengthTicks);
-    x = constrain(x, 4, 124);
-
-    // Y position based on note pitch (map MIDI note to 34 pixel range)
-    // Use note modulo 36 to fit ~3 octaves, inverted so high notes are at top
-    int noteOffset = evt.note % 36;  // 3 octaves range
-    int y = 47 - (noteOffset * 33) / 35;  // Map to 14-47 range
-
-    // Check if this is a recently added note
-    bool isRecent = isNewNoteFlash &&
-                    evt.timestamp == looper.lastRecordTick &&
-                    evt.note == looper.lastRecordNote;
-
-    if (isRecent) {
-      // Animated expanding circle for new notes
-      int pulseSize = 2 + ((now - looper.lastRecordTime) / 50) % 4;
-      display.drawCircle(x, y, pulseSize, WHITE);
-      display.fillCircle(x, y, 2, WHITE);
-    } else {
-      // Normal dot for existing notes
-      display.fillCircle(x, y, 1, WHITE);
-    }
+  if (now - lp.lastRecordTime < 400 && lp.lastRecordTrack == view.track && lp.lastRecordTick < view.spanTicks) {
+    int x = looperRollX(lp.lastRecordTick, view.spanTicks);
+    int y = looperRollY(lp.lastRecordNote);
+    int pulseSize = 2 + ((now - lp.lastRecordTime) / 50) % 4;
+    display.drawCircle(x, y, pulseSize, WHITE);
+    display.fillCircle(x, y, 2, WHITE);
   }
 
   // Playhead - simple vertical line with small triangle at top
-  if (looper.loopLengthTicks > 0 && (looper.playing || looper.recording || looper.overdubbing)) {
-    int playheadX = 4 + ((looper.currentTick * 120) / looper.loopLengthTicks);
+  if (lp.playing) {
+    int playheadX = 4 + ((tr.currentTick * 120) / view.spanTicks);
     playheadX = constrain(playheadX, 4, 124);
 
     // Thin line
@@ -353,9 +1293,9 @@ void drawLooperScreen() {
   // Divider line
   display.drawFastHLine(0, 50, 128, WHITE);
 
-  // Bottom: beat counter + note count
+  // Bottom: beat counter, newest layer's memory, note count
   display.setTextSize(1);
-  int currentBeat = (looper.currentTick / LOOP_TICKS_PER_BEAT) + 1;
+  int currentBeat = (tr.currentTick / LOOP_TICKS_PER_BEAT) + 1;
 
   // Left: beat
   display.setCursor(4, 54);
@@ -363,13 +1303,24 @@ void drawLooperScreen() {
   display.print("/");
   display.print(totalBeats);
 
-  // Right: note count (only note-ons)
-  int noteOnCount = 0;
-  for (int i = 0; i < looper.eventCount; i++) {
-    if (!LOOP_EVENT_IS_OFF(looper.events[i])) noteOnCount++;
+  // Center: newest visible layer / layers recorded, and the pool memory the
+  // newest visible layer takes
+  if (tr.visibleLayers > 0) {
+    char layerStr[12];
+    uint32_t bytes = (uint32_t)tr.layerEvents[tr.visibleLayers - 1] * sizeof(LoopEvent);
+    if (bytes < 1000) {
+      snprintf(layerStr, sizeof(layerStr), "L%d/%d %luB", tr.visibleLayers, tr.layerCount, (unsigned long)bytes);
+    } else {
+      snprintf(layerStr, sizeof(layerStr), "L%d/%d %lu.%luK", tr.visibleLayers, tr.layerCount,
+               (unsigned long)(bytes / 1024), (unsigned long)((bytes % 1024) * 10 / 1024));
+    }
+    display.setCursor(64 - strlen(layerStr) * 3, 54);
+    display.print(layerStr);
   }
+
+  // Right: note count (only note-ons, visible layers)
   char noteStr[12];
-  snprintf(noteStr, sizeof(noteStr), "%d notes", noteOnCount);
+  snprintf(noteStr, sizeof(noteStr), "%dn", tr.noteOnCount);
   int w = strlen(noteStr) * 6;
   display.setCursor(124 - w, 54);
   display.print(noteStr);
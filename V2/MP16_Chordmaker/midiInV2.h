@@ -0,0 +1,159 @@
+#ifndef MIDI_IN_V2_H
+#define MIDI_IN_V2_H
+
+#include <hardware/sync.h>
+
+//================================ MIDI INPUT DEFINES ================================
+// One byte-stream parser shared by DIN and USB input (one instance per source).
+// Handles running status, 1- and 2-data-byte messages, SysEx framing and
+// realtime bytes interleaved anywhere. No allocation - state is 8 bytes.
+// Uses midiMessageLength() from midiOutV2.h (include that first).
+
+#define MIDI_SOURCE_DIN 0
+#define MIDI_SOURCE_USB 1
+
+#define MIDI_RX_RING_SIZE 256   // DIN bytes buffered between UART IRQ and updateMIDI (~80ms at full rate)
+
+//================================ DATA STRUCTURES ================================
+
+// A fully decoded message (data bytes beyond the message length are 0)
+struct MidiEvent {
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+struct MidiParser {
+  uint8_t status = 0;        // Status of the message being assembled (0 = none)
+  uint8_t expected = 0;      // Data bytes that status needs
+  uint8_t dataCount = 0;     // Data bytes received so far
+  uint8_t data[2] = {0, 0};
+  bool inSysEx = false;      // Between F0 and F7 - data bytes are swallowed
+
+  // Counters
+  uint16_t strayBytes = 0;   // Data bytes with no status to attach to
+  uint16_t sysExCount = 0;   // Complete or interrupted SysEx messages
+};
+
+// Timestamped DIN receive ring - single producer (UART interrupt),
+// single consumer (updateMIDI), no locking needed
+struct MidiRxRing {
+  uint8_t data[MIDI_RX_RING_SIZE];
+  uint32_t time[MIDI_RX_RING_SIZE];   // micros() when the byte arrived
+  volatile uint16_t head = 0;         // Written by the interrupt only
+  volatile uint16_t tail = 0;         // Written by the main loop only
+  volatile uint16_t overflows = 0;    // Bytes lost because the ring was full
+  volatile uint16_t uartOverruns = 0; // Bytes lost in the UART itself
+};
+
+//================================ RX RING ================================
+
+// Interrupt side
+inline void midiRxRingPush(MidiRxRing& r, uint8_t b, uint32_t t) {
+  uint16_t next = (r.head + 1) & (MIDI_RX_RING_SIZE - 1);
+  if (next == r.tail) {
+    r.overflows++;
+    return;
+  }
+  r.data[r.head] = b;
+  r.time[r.head] = t;
+  __dmb();          // Byte and timestamp visible before the new head
+  r.head = next;
+}
+
+// Main loop side
+inline bool midiRxRingPop(MidiRxRing& r, uint8_t& b, uint32_t& t) {
+  if (r.tail == r.head) return false;
+  __dmb();
+  b = r.data[r.tail];
+  t = r.time[r.tail];
+  r.tail = (r.tail + 1) & (MIDI_RX_RING_SIZE - 1);
+  return true;
+}
+
+//================================ PARSER ================================
+
+// Feed one byte. Returns true (and fills evt) when a message is complete.
+// Realtime bytes are returned immediately and leave the message in progress
+// untouched; a channel status stays active afterwards (running status);
+// system common and SysEx cancel it.
+bool midiParserFeed(MidiParser& p, uint8_t b, MidiEvent& evt) {
+  // Realtime: single byte, may appear between any two bytes
+  if (b >= 0xF8) {
+    if (b == 0xF9 || b == 0xFD) return false;  // Undefined
+    evt.status = b;
+    evt.data1 = 0;
+    evt.data2 = 0;
+    return true;
+  }
+
+  if (b >= 0x80) {
+    // Any non-realtime status byte ends a SysEx (F7 is the polite way)
+    if (p.inSysEx) {
+      p.inSysEx = false;
+      p.sysExCount++;
+      if (b == 0xF7) return false;
+    }
+
+    p.dataCount = 0;
+    if (b == 0xF0) {
+      p.inSysEx = true;
+      p.status = 0;
+      return false;
+    }
+    if (b == 0xF7 || b == 0xF4 || b == 0xF5) {
+      p.status = 0;  // Stray EOX / undefined system common
+      return false;
+    }
+
+    p.status = b;
+    p.expected = midiMessageLength(b) - 1;
+    if (p.expected == 0) {
+      // Tune request (F6) - complete on its own
+      p.status = 0;
+      evt.status = b;
+      evt.data1 = 0;
+      evt.data2 = 0;
+      return true;
+    }
+    return false;
+  }
+
+  // Data byte
+  if (p.inSysEx) return false;
+  if (p.status == 0) {
+    p.strayBytes++;
+    return false;
+  }
+
+  p.data[p.dataCount++] = b;
+  if (p.dataCount < p.expected) return false;
+
+  evt.status = p.status;
+  evt.data1 = p.data[0];
+  evt.data2 = (p.expected > 1) ? p.data[1] : 0;
+  p.dataCount = 0;
+  if (p.status >= 0xF0) {
+    p.status = 0;  // System common has no running status
+  }
+  return true;
+}
+
+// Number of MIDI bytes carried by a USB-MIDI event packet, from its CIN.
+// The packet's status position is never trusted on its own - these bytes are
+// fed through the same parser as DIN so malformed packets can't misroute.
+uint8_t midiUsbPacketLength(uint8_t cin) {
+  switch (cin) {
+    case 0x5: case 0xF:                         // 1-byte system / SysEx end, single byte
+      return 1;
+    case 0x2: case 0x6: case 0xC: case 0xD:     // 2-byte system, SysEx end, PC, pressure
+      return 2;
+    case 0x3: case 0x4: case 0x7:               // 3-byte system, SysEx start/continue/end
+    case 0x8: case 0x9: case 0xA: case 0xB: case 0xE:
+      return 3;
+    default:                                    // 0x0/0x1 reserved
+      return 0;
+  }
+}
+
+#endif // MIDI_IN_V2_H
@@ -0,0 +1,581 @@
+#ifndef MIDI_OUT_V2_H
+#define MIDI_OUT_V2_H
+
+#include <hardware/uart.h>
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+//================================ MIDI OUTPUT DEFINES ================================
+// Every outgoing message goes through a per-port queue instead of blocking on
+// Serial1/usb_midi. Three lanes per port, drained in this order:
+//   realtime - 0xF8..0xFF single bytes (may even interleave mid-message on DIN)
+//   high     - note-offs (a released note should never wait behind new note-ons)
+//   normal   - note-ons, CCs, pitch bend, thru traffic
+#define MIDI_OUT_PORT_DIN   0
+#define MIDI_OUT_PORT_USB   1
+#define NUM_MIDI_OUT_PORTS  2
+
+#define MIDI_OUT_TO_DIN     (1 << MIDI_OUT_PORT_DIN)
+#define MIDI_OUT_TO_USB     (1 << MIDI_OUT_PORT_USB)
+#define MIDI_OUT_TO_ALL     (MIDI_OUT_TO_DIN | MIDI_OUT_TO_USB)
+
+#define MIDI_OUT_QUEUE_SIZE     128  // Messages per lane (power of 2)
+#define MIDI_OUT_RT_QUEUE_SIZE  32   // Realtime bytes per port (power of 2)
+
+#define MIDI_DIN_UART uart0          // Serial1 (TX_PIN/RX_PIN) is UART0
+
+#define MIDI_USB_BATCH_BYTES    192  // MIDI bytes handed to TinyUSB per refill (64 full messages)
+
+// DIN serializer options
+#define MIDI_DIN_RUNNING_STATUS      true     // Omit repeated status bytes
+#define MIDI_DIN_NOTE_OFF_AS_VEL0    true     // Send 0x80 as 0x90 vel 0 (keeps running status alive)
+#define MIDI_DIN_STATUS_REFRESH_US   300000   // Resend a full status at least this often (hot-plugged gear)
+#define MIDI_DIN_BYTES_PER_SEC       3125     // 31250 baud / 10 bits per byte
+
+// Overflow policy:
+// - normal lane full: the NEW message is dropped and counted (dropped)
+// - pending pitch bend / same-CC updates are overwritten in place (coalesced)
+//   so glide streams can't fill the queue with stale values
+// - realtime is never dropped from loop(): if its queue is full the port is
+//   drained synchronously until there is room (the old blocking behaviour)
+// - note-offs are never dropped at all:
+//   - a note-off for a note that already has one waiting in the high lane
+//     is merged with it
+//   - if the high lane is still full (a USB host that isn't reading, or
+//     interrupt context - which never waits, not even for DIN), the
+//     note-off is kept as a bit per channel/note (offOverflow) and sent
+//     after the high lane, before the normal lane. The bit has no room for
+//     the release velocity: those note-offs go out with velocity 0
+//   - a note-off that must wait behind its note-on but finds the normal
+//     lane full cancels that note-on instead, so the note never starts
+
+//================================ DATA STRUCTURES ================================
+
+// One queued channel/system message - length is derived from the status byte
+struct MidiOutMsg {
+  uint8_t status;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+// Single lane ring buffer (head = write, tail = read)
+struct MidiOutQueue {
+  MidiOutMsg msgs[MIDI_OUT_QUEUE_SIZE];
+  uint16_t head = 0;
+  uint16_t tail = 0;
+};
+
+struct MidiOutPort {
+  MidiOutQueue high;
+  MidiOutQueue normal;
+  uint8_t offOverflow[16][16] = {}; // Note-offs the high lane had no room for (bit per channel/note)
+  uint16_t offOverflowCount = 0;
+  uint8_t realtime[MIDI_OUT_RT_QUEUE_SIZE];
+  uint16_t rtHead = 0;
+  uint16_t rtTail = 0;
+
+  // Message currently being shifted out (DIN only - FIFO may fill mid-message)
+  uint8_t txBuf[3];
+  uint8_t txLen = 0;
+  uint8_t txPos = 0;
+
+  // DIN serializer state
+  bool useRunningStatus = MIDI_DIN_RUNNING_STATUS;
+  bool noteOffAsNoteOn = MIDI_DIN_NOTE_OFF_AS_VEL0;
+  uint8_t runningStatus = 0;        // Last channel status on the wire (0 = none)
+  uint32_t runningStatusTime = 0;   // time_us_32() when it was last sent in full
+
+  // MIDI bytes waiting for TinyUSB (USB only)
+  uint8_t usbBatch[MIDI_USB_BATCH_BYTES];
+  uint16_t usbBatchLen = 0;
+  uint16_t usbBatchSent = 0;
+  uint8_t usbBatchMsgs = 0;         // Messages in the batch (counted as sent once it is all out)
+
+  // Byte accounting (per second window)
+  uint32_t bytesTotal = 0;          // Bytes on the wire since boot (USB: MIDI bytes, not packets)
+  uint32_t statusBytesSaved = 0;    // Status bytes skipped thanks to running status
+  uint32_t bytesThisSecond = 0;
+  uint32_t bytesLastSecond = 0;     // Completed window - read this one
+  uint8_t utilization = 0;          // DIN only: % of 31250 baud used last second (USB has no fixed rate)
+  uint32_t windowStart = 0;
+
+  // Counters
+  uint32_t sent = 0;           // Messages handed to the hardware
+  uint32_t dropped = 0;        // Messages lost to overflow (or USB not mounted)
+  uint32_t coalesced = 0;      // Pending updates overwritten by a newer value (or duplicate note-offs)
+  uint32_t offsDeferred = 0;   // Note-offs kept in offOverflow or that cancelled their note-on
+  uint16_t highWater = 0;      // Deepest normal-lane depth seen
+};
+
+// Global output ports (declared in main sketch)
+extern MidiOutPort midiOutPorts[NUM_MIDI_OUT_PORTS];
+
+// External references
+extern Adafruit_USBD_MIDI usb_midi;
+
+//================================ QUEUE HELPERS ================================
+
+// All queue access happens with interrupts off: producers run in loop(),
+// the DIN consumer runs in the UART TX interrupt (midiInterruptHandler).
+inline uint32_t midiOutLock() {
+  return save_and_disable_interrupts();
+}
+
+inline void midiOutUnlock(uint32_t saved) {
+  restore_interrupts(saved);
+}
+
+// Number of bytes in a message with this status byte (including status)
+uint8_t midiMessageLength(uint8_t status) {
+  if (status < 0xF0) {
+    uint8_t command = status & 0xF0;
+    return (command == 0xC0 || command == 0xD0) ? 2 : 3;
+  }
+  switch (status) {
+    case 0xF1: // MTC quarter frame
+    case 0xF3: // Song select
+      return 2;
+    case 0xF2: // Song position
+      return 3;
+    default:   // Tune request, realtime
+      return 1;
+  }
+}
+
+inline uint16_t midiOutQueueDepth(const MidiOutQueue& q) {
+  return (q.head - q.tail) & (MIDI_OUT_QUEUE_SIZE - 1);
+}
+
+inline bool midiOutQueueFull(const MidiOutQueue& q) {
+  return midiOutQueueDepth(q) == MIDI_OUT_QUEUE_SIZE - 1;
+}
+
+inline void midiOutQueuePush(MidiOutQueue& q, const MidiOutMsg& msg) {
+  q.msgs[q.head] = msg;
+  q.head = (q.head + 1) & (MIDI_OUT_QUEUE_SIZE - 1);
+}
+
+inline bool midiOutQueuePop(MidiOutQueue& q, MidiOutMsg& msg) {
+  if (q.head == q.tail) return false;
+  msg = q.msgs[q.tail];
+  q.tail = (q.tail + 1) & (MIDI_OUT_QUEUE_SIZE - 1);
+  return true;
+}
+
+// Overwrite a still-pending pitch bend (same channel) or CC (same channel+number)
+// Only CC numbers that carry a continuous value are safe to merge - RPN/NRPN
+// selects and data entry must keep their order and count. The search stops at
+// the first note message on that channel so a value never hops over a note.
+bool midiOutCoalesce(MidiOutPort& port, const MidiOutMsg& msg) {
+  uint8_t command = msg.status & 0xF0;
+  uint8_t channel = msg.status & 0x0F;
+  if (command == 0xB0) {
+    if (msg.data1 == 6 || msg.data1 == 38 || (msg.data1 >= 96 && msg.data1 <= 101)) return false;
+  } else if (command != 0xE0) {
+    return false;
+  }
+
+  uint16_t i = port.normal.head;
+  while (i != port.normal.tail) {
+    i = (i - 1) & (MIDI_OUT_QUEUE_SIZE - 1);
+    MidiOutMsg& pending = port.normal.msgs[i];
+    uint8_t pendingCommand = pending.status & 0xF0;
+    if ((pending.status & 0x0F) == channel && (pendingCommand == 0x80 || pendingCommand == 0x90)) {
+      break;  // Keep value changes on the same side of the note they followed
+    }
+    if (pending.status == msg.status && (command == 0xE0 || pending.data1 == msg.data1)) {
+      pending.data2 = msg.data2;
+      if (command == 0xE0) pending.data1 = msg.data1;
+      port.coalesced++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// True if a note-on for this channel/note is still waiting in the normal lane
+// (its note-off must then stay behind it, or the note would hang)
+bool midiOutNoteOnPending(MidiOutPort& port, uint8_t channel, uint8_t note) {
+  uint8_t onStatus = 0x90 | channel;
+  for (uint16_t i = port.normal.tail; i != port.normal.head; i = (i + 1) & (MIDI_OUT_QUEUE_SIZE - 1)) {
+    if (port.normal.msgs[i].status == onStatus && port.normal.msgs[i].data1 == note) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Merge a note-off into one already waiting in the high lane for the same note
+bool midiOutNoteOffPending(MidiOutPort& port, uint8_t channel, uint8_t note) {
+  for (uint16_t i = port.high.tail; i != port.high.head; i = (i + 1) & (MIDI_OUT_QUEUE_SIZE - 1)) {
+    if ((port.high.msgs[i].status & 0x0F) == channel && port.high.msgs[i].data1 == note) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Keep a note-off the high lane has no room for (its release velocity is lost)
+void midiOutOverflowNoteOff(MidiOutPort& port, uint8_t channel, uint8_t note) {
+  uint8_t& bits = port.offOverflow[channel][note >> 3];
+  uint8_t bit = 1 << (note & 7);
+  if (!(bits & bit)) {
+    bits |= bit;
+    port.offOverflowCount++;
+  }
+  port.offsDeferred++;
+}
+
+bool midiOutPopOverflowNoteOff(MidiOutPort& port, MidiOutMsg& msg) {
+  if (port.offOverflowCount == 0) return false;
+  for (uint8_t channel = 0; channel < 16; channel++) {
+    for (uint8_t i = 0; i < 16; i++) {
+      uint8_t bits = port.offOverflow[channel][i];
+      if (!bits) continue;
+      uint8_t b = 0;
+      while (!(bits & (1 << b))) b++;
+      port.offOverflow[channel][i] = bits & ~(1 << b);
+      port.offOverflowCount--;
+      msg = {(uint8_t)(0x80 | channel), (uint8_t)(i * 8 + b), 0};
+      return true;
+    }
+  }
+  port.offOverflowCount = 0;
+  return false;
+}
+
+// The normal lane is full and a note-off has to wait behind its note-on:
+// turn the newest pending note-on for that note into the note-off instead
+void midiOutCancelNoteOn(MidiOutPort& port, uint8_t channel, uint8_t note) {
+  uint8_t onStatus = 0x90 | channel;
+  uint16_t i = port.normal.head;
+  while (i != port.normal.tail) {
+    i = (i - 1) & (MIDI_OUT_QUEUE_SIZE - 1);
+    MidiOutMsg& pending = port.normal.msgs[i];
+    if (pending.status == onStatus && pending.data1 == note && pending.data2 > 0) {
+      pending.status = 0x80 | channel;
+      pending.data2 = 0;
+      port.offsDeferred++;
+      return;
+    }
+  }
+}
+
+//================================ BYTE ACCOUNTING ================================
+
+// utilization is only worked out for DIN - a USB port's bytes are counted,
+// but full-speed USB has no baud rate to compare them against
+void midiOutCountBytes(MidiOutPort& port, uint8_t count) {
+  port.bytesTotal += count;
+  port.bytesThisSecond += count;
+
+  uint32_t now = time_us_32();
+  if (now - port.windowStart >= 1000000UL) {
+    port.bytesLastSecond = port.bytesThisSecond;
+    if (&port == &midiOutPorts[MIDI_OUT_PORT_DIN]) {
+      port.utilization = min(100, (int)(port.bytesLastSecond * 100UL / MIDI_DIN_BYTES_PER_SEC));
+    }
+    port.bytesThisSecond = 0;
+    port.windowStart = now;
+  }
+}
+
+//================================ DIN SERIALIZER ================================
+
+// Load the next queued message into txBuf, applying running status.
+// Realtime bytes never touch runningStatus (they may sit between any two
+// bytes), system common messages cancel it as the MIDI spec requires.
+void midiOutSerializeDin(MidiOutPort& port, MidiOutMsg msg) {
+  uint8_t command = msg.status & 0xF0;
+
+  if (port.noteOffAsNoteOn && command == 0x80) {
+    msg.status = 0x90 | (msg.status & 0x0F);
+    msg.data2 = 0;
+  }
+
+  uint8_t len = midiMessageLength(msg.status);
+  port.txBuf[0] = msg.status;
+  port.txBuf[1] = msg.data1;
+  port.txBuf[2] = msg.data2;
+  port.txLen = len;
+  port.txPos = 0;
+
+  if (msg.status >= 0xF0) {
+    port.runningStatus = 0;  // System common: next channel message needs its status
+    return;
+  }
+
+  uint32_t now = time_us_32();
+  if (port.useRunningStatus && msg.status == port.runningStatus &&
+      now - port.runningStatusTime < MIDI_DIN_STATUS_REFRESH_US) {
+    port.txPos = 1;  // Skip the status byte
+    port.statusBytesSaved++;
+  } else {
+    port.runningStatus = msg.status;
+    port.runningStatusTime = now;
+  }
+}
+
+//================================ USB BATCH ================================
+
+// Append a message to the USB batch with its status byte - TinyUSB's stream
+// parser packs the bytes into event packets itself (cable 0)
+void midiUsbAppend(MidiOutPort& port, uint8_t status, uint8_t data1, uint8_t data2) {
+  uint8_t len = midiMessageLength(status);
+  port.usbBatch[port.usbBatchLen++] = status;
+  if (len > 1) port.usbBatch[port.usbBatchLen++] = data1;
+  if (len > 2) port.usbBatch[port.usbBatchLen++] = data2;
+  port.usbBatchMsgs++;
+}
+
+//================================ PORT DRAINING ================================
+
+// Next message of a port: high lane, then overflowed note-offs, then normal
+bool midiOutPopNext(MidiOutPort& port, MidiOutMsg& msg) {
+  return midiOutQueuePop(port.high, msg) || midiOutPopOverflowNoteOff(port, msg) ||
+         midiOutQueuePop(port.normal, msg);
+}
+
+inline bool midiOutAnyQueued(const MidiOutPort& port) {
+  return port.high.head != port.high.tail || port.offOverflowCount > 0 ||
+         port.normal.head != port.normal.tail;
+}
+
+// Fill the UART transmitter from the queues (call with interrupts disabled).
+// Leaves the TX interrupt enabled only while something is still waiting, so
+// the UART pulls the next byte itself as soon as the previous one is out.
+void midiOutDrainDin() {
+  MidiOutPort& port = midiOutPorts[MIDI_OUT_PORT_DIN];
+
+  while (uart_is_writable(MIDI_DIN_UART)) {
+    // Realtime bytes are legal anywhere in the stream, even between data bytes
+    if (port.rtHead != port.rtTail) {
+      uart_putc_raw(MIDI_DIN_UART, port.realtime[port.rtTail]);
+      port.rtTail = (port.rtTail + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1);
+      port.sent++;
+      midiOutCountBytes(port, 1);
+      continue;
+    }
+
+    if (port.txPos >= port.txLen) {
+      MidiOutMsg msg;
+      if (!midiOutPopNext(port, msg)) {
+        break;  // Nothing left to send
+      }
+      midiOutSerializeDin(port, msg);
+      port.sent++;
+    }
+
+    uart_putc_raw(MIDI_DIN_UART, port.txBuf[port.txPos++]);
+    midiOutCountBytes(port, 1);
+  }
+
+  bool morePending = (port.rtHead != port.rtTail) || (port.txPos < port.txLen) || midiOutAnyQueued(port);
+  if (morePending) {
+    hw_set_bits(&uart_get_hw(MIDI_DIN_UART)->imsc, UART_UARTIMSC_TXIM_BITS);
+  } else {
+    hw_clear_bits(&uart_get_hw(MIDI_DIN_UART)->imsc, UART_UARTIMSC_TXIM_BITS);
+  }
+}
+
+// Hand queued messages to TinyUSB (main loop only - this is the USB task side).
+// Everything queued since the last pass is serialized into one byte batch and
+// given to TinyUSB with a single usb_midi.write(), which flushes once at the
+// end - a whole chord goes out in one endpoint transfer. writePacket() would
+// flush after every packet. Bytes TinyUSB can't take yet stay in the batch
+// for the next pass (its stream parser keeps a half-written message).
+void midiOutDrainUsb() {
+  MidiOutPort& port = midiOutPorts[MIDI_OUT_PORT_USB];
+
+  if (!TinyUSBDevice.mounted()) {
+    // No host listening - discard so the queue doesn't replay stale notes later
+    uint32_t saved = midiOutLock();
+    port.dropped += midiOutQueueDepth(port.high) + midiOutQueueDepth(port.normal)
+                  + port.offOverflowCount
+                  + ((port.rtHead - port.rtTail) & (MIDI_OUT_RT_QUEUE_SIZE - 1))
+                  + (port.usbBatchSent < port.usbBatchLen ? port.usbBatchMsgs : 0);
+    port.high.tail = port.high.head;
+    port.normal.tail = port.normal.head;
+    memset(port.offOverflow, 0, sizeof(port.offOverflow));
+    port.offOverflowCount = 0;
+    port.rtTail = port.rtHead;
+    port.usbBatchLen = 0;
+    port.usbBatchSent = 0;
+    port.usbBatchMsgs = 0;
+    midiOutUnlock(saved);
+    return;
+  }
+
+  if (port.usbBatchSent >= port.usbBatchLen) {
+    // Refill: realtime first, then note-offs, then everything else
+    port.usbBatchLen = 0;
+    port.usbBatchSent = 0;
+    port.usbBatchMsgs = 0;
+
+    uint32_t saved = midiOutLock();
+    while (port.rtHead != port.rtTail && port.usbBatchLen < MIDI_USB_BATCH_BYTES) {
+      midiUsbAppend(port, port.realtime[port.rtTail], 0, 0);
+      port.rtTail = (port.rtTail + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1);
+    }
+    MidiOutMsg msg;
+    while (port.usbBatchLen + 3 <= MIDI_USB_BATCH_BYTES && midiOutPopNext(port, msg)) {
+      midiUsbAppend(port, msg.status, msg.data1, msg.data2);
+    }
+    midiOutUnlock(saved);
+
+    if (port.usbBatchLen == 0) return;  // Nothing queued
+  }
+
+  // One write (and one flush) per pass; a full TinyUSB FIFO takes only part
+  size_t taken = usb_midi.write(port.usbBatch + port.usbBatchSent, port.usbBatchLen - port.usbBatchSent);
+  port.usbBatchSent += taken;
+  midiOutCountBytes(port, taken);
+  if (port.usbBatchSent >= port.usbBatchLen) {
+    port.sent += port.usbBatchMsgs;
+  }
+}
+
+// Make room in a full lane by draining synchronously (note-offs/realtime only).
+// USB gets one drain - the host may not be reading, so the lane can still be full.
+void midiOutWaitForRoom(int portIndex, MidiOutQueue* q) {
+  if (portIndex == MIDI_OUT_PORT_USB) {
+    midiOutDrainUsb();
+    return;
+  }
+  // DIN always makes progress at 31250 baud
+  while (q ? midiOutQueueFull(*q)
+           : (((midiOutPorts[portIndex].rtHead + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1)) == midiOutPorts[portIndex].rtTail)) {
+    uint32_t saved = midiOutLock();
+    midiOutDrainDin();
+    midiOutUnlock(saved);
+  }
+}
+
+//================================ PUBLIC API ================================
+
+// Queue a channel or system common message. mayWait=false (interrupt context)
+// never drains a port - spinning on DIN there would keep interrupts off for
+// whole byte times and lose MIDI input. A note-off that doesn't fit is kept
+// in offOverflow instead.
+void midiOutEnqueue(uint8_t status, uint8_t data1, uint8_t data2, uint8_t portMask, bool mayWait) {
+  MidiOutMsg msg = {status, data1, data2};
+  uint8_t command = status & 0xF0;
+  bool isNoteOff = (command == 0x80) || (command == 0x90 && data2 == 0);
+
+  for (int p = 0; p < NUM_MIDI_OUT_PORTS; p++) {
+    if (!(portMask & (1 << p))) continue;
+    MidiOutPort& port = midiOutPorts[p];
+
+    uint32_t saved = midiOutLock();
+    MidiOutQueue* lane = &port.normal;
+    if (isNoteOff && !midiOutNoteOnPending(port, status & 0x0F, data1)) {
+      lane = &port.high;
+    }
+
+    if (lane == &port.normal ? midiOutCoalesce(port, msg)
+                             : midiOutNoteOffPending(port, status & 0x0F, data1)) {
+      if (lane == &port.high) port.coalesced++;
+      midiOutUnlock(saved);
+      continue;
+    }
+
+    if (midiOutQueueFull(*lane)) {
+      if (!isNoteOff) {
+        port.dropped++;
+        midiOutUnlock(saved);
+        continue;
+      }
+      if (mayWait) {
+        midiOutUnlock(saved);
+        midiOutWaitForRoom(p, lane);
+        saved = midiOutLock();
+        // Draining may have sent the note-on this note-off was waiting for
+        if (lane == &port.normal && !midiOutNoteOnPending(port, status & 0x0F, data1)) {
+          lane = &port.high;
+        }
+      }
+      if (midiOutQueueFull(*lane)) {
+        if (lane == &port.high) {
+          midiOutOverflowNoteOff(port, status & 0x0F, data1);
+        } else {
+          midiOutCancelNoteOn(port, status & 0x0F, data1);
+        }
+        midiOutUnlock(saved);
+        continue;
+      }
+    }
+
+    midiOutQueuePush(*lane, msg);
+    uint16_t depth = midiOutQueueDepth(port.normal);
+    if (depth > port.highWater) port.highWater = depth;
+
+    if (p == MIDI_OUT_PORT_DIN) {
+      midiOutDrainDin();  // Start shifting immediately if the UART is idle
+    }
+    midiOutUnlock(saved);
+  }
+}
+
+// Queue a channel or system common message on the selected ports
+void midiOutSend(uint8_t status, uint8_t data1, uint8_t data2, uint8_t portMask = MIDI_OUT_TO_ALL) {
+  midiOutEnqueue(status, data1, data2, portMask, true);
+}
+
+// Same from a timer/alarm callback
+void midiOutSendIrq(uint8_t status, uint8_t data1, uint8_t data2, uint8_t portMask = MIDI_OUT_TO_ALL) {
+  midiOutEnqueue(status, data1, data2, portMask, false);
+}
+
+// Queue a realtime byte (0xF8 clock, 0xFA start, 0xFC stop...) ahead of everything
+void midiOutSendRealtime(uint8_t rt, uint8_t portMask = MIDI_OUT_TO_ALL) {
+  for (int p = 0; p < NUM_MIDI_OUT_PORTS; p++) {
+    if (!(portMask & (1 << p))) continue;
+    MidiOutPort& port = midiOutPorts[p];
+
+    if (((port.rtHead + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1)) == port.rtTail) {
+      midiOutWaitForRoom(p, NULL);
+    }
+
+    uint32_t saved = midiOutLock();
+    port.realtime[port.rtHead] = rt;
+    port.rtHead = (port.rtHead + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1);
+    if (p == MIDI_OUT_PORT_DIN) {
+      midiOutDrainDin();
+    }
+    midiOutUnlock(saved);
+  }
+}
+
+// Interrupt-safe version for timer callbacks: never waits for room (USB can
+// only be drained from loop), a byte that doesn't fit is dropped and counted
+void midiOutSendRealtimeIrq(uint8_t rt, uint8_t portMask = MIDI_OUT_TO_ALL) {
+  uint32_t saved = midiOutLock();
+  for (int p = 0; p < NUM_MIDI_OUT_PORTS; p++) {
+    if (!(portMask & (1 << p))) continue;
+    MidiOutPort& port = midiOutPorts[p];
+
+    if (((port.rtHead + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1)) == port.rtTail) {
+      port.dropped++;
+      continue;
+    }
+    port.realtime[port.rtHead] = rt;
+    port.rtHead = (port.rtHead + 1) & (MIDI_OUT_RT_QUEUE_SIZE - 1);
+    if (p == MIDI_OUT_PORT_DIN) {
+      midiOutDrainDin();
+    }
+  }
+  midiOutUnlock(saved);
+}
+
+// Service queues from loop() - USB is drained here, DIN gets a top-up
+void midiOutService() {
+  midiOutDrainUsb();
+  uint32_t saved = midiOutLock();
+  midiOutDrainDin();
+  // Close the accounting window even when nothing is being sent
+  midiOutCountBytes(midiOutPorts[MIDI_OUT_PORT_DIN], 0);
+  midiOutCountBytes(midiOutPorts[MIDI_OUT_PORT_USB], 0);
+  midiOutUnlock(saved);
+}
+
+#endif // MIDI_OUT_V2_H
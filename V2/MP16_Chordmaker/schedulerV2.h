@@ -0,0 +1,304 @@
+#ifndef SCHEDULER_V2_H
+#define SCHEDULER_V2_H
+
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+//================================ SCHEDULER DEFINES ================================
+// Fixed-capacity queue of future events keyed by a micros() deadline (binary
+// min-heap). One hardware alarm is always armed for the earliest deadline.
+// When it fires:
+//   note-on / note-off / CC - sent straight into the MIDI output queues from
+//                             the alarm interrupt, so they leave on time
+//                             whatever the display or LEDs are doing
+//   callback                - not run in the interrupt (it touches state the
+//                             main loop owns), handed to loop() instead
+// Every fired event is also copied to a log that loop() drains, so side
+// effects (looper recording, arp/glide bookkeeping) happen there.
+// Events carry an owner tag so a whole group can be cancelled or pulled in.
+
+#define SCHED_CAPACITY    64     // Pending events
+#define SCHED_FIRED_SIZE  64     // Fired events waiting for loop() (power of 2)
+
+enum SchedType : uint8_t {
+  SCHED_NOTE_OFF,   // Order matters: at equal deadlines a note-off goes first
+  SCHED_CC,         // CC (or any other channel message - pitch bend...)
+  SCHED_NOTE_ON,
+  SCHED_CALLBACK
+};
+
+#define SCHED_OWNER_NONE      0
+#define SCHED_OWNER_ARP_STEP  1   // Delayed arp steps (swing, humanize, stutter)
+#define SCHED_OWNER_ARP_GATE  2   // Arp gate-offs
+#define SCHED_OWNER_GLIDE     3   // Glide overlap release
+#define SCHED_OWNER_LOOPER    4   // Looper playback between clock ticks; track n is SCHED_OWNER_LOOPER + n
+
+typedef void (*SchedCallback)(uint8_t arg);
+
+//================================ DATA STRUCTURES ================================
+
+struct SchedEvent {
+  uint32_t due;             // micros() deadline (fired log: when it was meant to go out)
+  SchedType type;
+  uint8_t owner;
+  uint8_t status;           // MIDI events: status/data as sent
+  uint8_t data1;            // Callbacks: data1 is passed as the argument
+  uint8_t data2;
+  uint8_t tag;              // Caller's use (arp notes: source pad, 0xFF = none)
+  SchedCallback callback;
+};
+
+struct Scheduler {
+  SchedEvent heap[SCHED_CAPACITY];
+  uint8_t count = 0;
+
+  // Alarm -> loop() log
+  SchedEvent fired[SCHED_FIRED_SIZE];
+  volatile uint8_t firedHead = 0;
+  volatile uint8_t firedTail = 0;
+
+  alarm_id_t alarm = 0;
+  bool alarmArmed = false;
+  uint32_t alarmDue = 0;
+
+  // Counters
+  uint16_t overflows = 0;       // Events refused because the heap was full
+  uint16_t firedOverflows = 0;  // Fired events loop() never saw (bookkeeping lost)
+  uint32_t maxLateUs = 0;       // Worst deadline miss seen by the alarm
+};
+
+//================================ HEAP ================================
+
+// Earlier deadline first; at equal deadlines, lower type first
+inline bool schedBefore(const SchedEvent& a, const SchedEvent& b) {
+  int32_t diff = (int32_t)(a.due - b.due);
+  if (diff != 0) return diff < 0;
+  return a.type < b.type;
+}
+
+void schedSiftUp(Scheduler& s, uint8_t i) {
+  while (i > 0) {
+    uint8_t parent = (i - 1) / 2;
+    if (!schedBefore(s.heap[i], s.heap[parent])) break;
+    SchedEvent tmp = s.heap[i];
+    s.heap[i] = s.heap[parent];
+    s.heap[parent] = tmp;
+    i = parent;
+  }
+}
+
+void schedSiftDown(Scheduler& s, uint8_t i) {
+  while (true) {
+    uint8_t left = i * 2 + 1;
+    uint8_t right = left + 1;
+    uint8_t smallest = i;
+    if (left < s.count && schedBefore(s.heap[left], s.heap[smallest])) smallest = left;
+    if (right < s.count && schedBefore(s.heap[right], s.heap[smallest])) smallest = right;
+    if (smallest == i) break;
+    SchedEvent tmp = s.heap[i];
+    s.heap[i] = s.heap[smallest];
+    s.heap[smallest] = tmp;
+    i = smallest;
+  }
+}
+
+// Restore heap order after several entries changed at once
+void schedHeapify(Scheduler& s) {
+  for (int i = s.count / 2 - 1; i >= 0; i--) {
+    schedSiftDown(s, i);
+  }
+}
+
+void schedRemoveAt(Scheduler& s, uint8_t i) {
+  s.count--;
+  if (i == s.count) return;
+  s.heap[i] = s.heap[s.count];
+  schedSiftDown(s, i);
+  schedSiftUp(s, i);
+}
+
+//================================ ALARM ================================
+
+// Hand a fired event to loop(). Interrupt context, or main code with IRQs off.
+void schedLogFired(Scheduler& s, const SchedEvent& e) {
+  uint8_t next = (s.firedHead + 1) & (SCHED_FIRED_SIZE - 1);
+  if (next == s.firedTail) {
+    s.firedOverflows++;
+  } else {
+    s.fired[s.firedHead] = e;
+    s.firedHead = next;
+  }
+}
+
+// Fire everything that's due. Interrupt context, or main code with IRQs off.
+void schedFireDue(Scheduler& s) {
+  uint32_t now = time_us_32();
+  while (s.count > 0 && (int32_t)(s.heap[0].due - now) <= 0) {
+    SchedEvent e = s.heap[0];
+    schedRemoveAt(s, 0);
+
+    uint32_t late = now - e.due;
+    if (late > s.maxLateUs) s.maxLateUs = late;
+
+    if (e.type != SCHED_CALLBACK) {
+      midiOutSendIrq(e.status, e.data1, e.data2);
+    }
+    schedLogFired(s, e);
+  }
+}
+
+int64_t schedAlarmCallback(alarm_id_t id, void* userData) {
+  Scheduler& s = *(Scheduler*)userData;
+  uint32_t saved = save_and_disable_interrupts();
+  schedFireDue(s);
+
+  int64_t next = 0;
+  s.alarmArmed = false;
+  if (s.count > 0) {
+    int32_t delay = (int32_t)(s.heap[0].due - time_us_32());
+    next = (delay > 1) ? delay : 1;   // Positive = from now
+    s.alarmArmed = true;
+    s.alarmDue = s.heap[0].due;
+    s.alarm = id;
+  }
+  restore_interrupts(saved);
+  return next;
+}
+
+// Make sure the alarm fires by the earliest deadline (IRQs off)
+void schedArm(Scheduler& s) {
+  if (s.count == 0) return;  // An armed alarm finds nothing and stops
+  uint32_t due = s.heap[0].due;
+  if (s.alarmArmed && (int32_t)(due - s.alarmDue) >= 0) return;
+
+  if (s.alarmArmed) cancel_alarm(s.alarm);
+  s.alarmArmed = true;
+  s.alarmDue = due;
+  int32_t delay = (int32_t)(due - time_us_32());
+  s.alarm = add_alarm_in_us((delay > 0) ? delay : 0, schedAlarmCallback, &s, true);
+  if (s.alarm <= 0) {
+    s.alarmArmed = false;  // Already fired (or no alarm slot) - nothing to wait for
+  }
+}
+
+//================================ PUBLIC API ================================
+
+bool schedulerAdd(Scheduler& s, const SchedEvent& e) {
+  uint32_t saved = save_and_disable_interrupts();
+  if (s.count >= SCHED_CAPACITY) {
+    s.overflows++;
+    restore_interrupts(saved);
+    return false;
+  }
+  s.heap[s.count] = e;
+  schedSiftUp(s, s.count);
+  s.count++;
+  schedFireDue(s);   // Due now - send before the caller carries on
+  schedArm(s);
+  restore_interrupts(saved);
+  return true;
+}
+
+bool schedulerMidi(Scheduler& s, uint32_t due, SchedType type, uint8_t owner,
+                   uint8_t status, uint8_t data1, uint8_t data2, uint8_t tag = 0xFF) {
+  SchedEvent e = {due, type, owner, status, data1, data2, tag, NULL};
+  return schedulerAdd(s, e);
+}
+
+bool schedulerCallback(Scheduler& s, uint32_t due, uint8_t owner, SchedCallback callback, uint8_t arg = 0) {
+  SchedEvent e = {due, SCHED_CALLBACK, owner, 0, arg, 0, 0xFF, callback};
+  return schedulerAdd(s, e);
+}
+
+// Drop every pending event of one owner
+void schedulerCancel(Scheduler& s, uint8_t owner) {
+  uint32_t saved = save_and_disable_interrupts();
+  uint8_t kept = 0;
+  for (int i = 0; i < s.count; i++) {
+    if (s.heap[i].owner != owner) s.heap[kept++] = s.heap[i];
+  }
+  s.count = kept;
+  schedHeapify(s);
+  restore_interrupts(saved);
+}
+
+// Cancel one owner's events, but send its pending note-offs now so nothing
+// it already started is left hanging
+void schedulerRelease(Scheduler& s, uint8_t owner) {
+  uint32_t saved = save_and_disable_interrupts();
+  uint8_t kept = 0;
+  for (int i = 0; i < s.count; i++) {
+    if (s.heap[i].owner != owner) {
+      s.heap[kept++] = s.heap[i];
+    } else if (s.heap[i].type == SCHED_NOTE_OFF) {
+      midiOutSendIrq(s.heap[i].status, s.heap[i].data1, s.heap[i].data2);
+    }
+  }
+  s.count = kept;
+  schedHeapify(s);
+  restore_interrupts(saved);
+}
+
+// Cancel everything (killAllNotes): pending note-offs are sent now so no
+// note is left hanging, the rest is dropped. The note-offs go in the fired
+// log too - a note-on still waiting there for loop() is then followed by
+// its note-off, and the voice it tracks is released again. They are logged
+// as due now, which is when they went out.
+void schedulerCancelAll(Scheduler& s) {
+  uint32_t saved = save_and_disable_interrupts();
+  uint32_t now = time_us_32();
+  for (int i = 0; i < s.count; i++) {
+    if (s.heap[i].type == SCHED_NOTE_OFF) {
+      midiOutSendIrq(s.heap[i].status, s.heap[i].data1, s.heap[i].data2);
+      SchedEvent sent = s.heap[i];
+      sent.due = now;
+      schedLogFired(s, sent);
+    }
+  }
+  s.count = 0;
+  restore_interrupts(saved);
+}
+
+// Make one owner's events happen no later than latest; anything pulled to
+// "now" fires immediately, before the caller sends anything else
+void schedulerPull(Scheduler& s, uint8_t owner, uint32_t latest) {
+  uint32_t saved = save_and_disable_interrupts();
+  for (int i = 0; i < s.count; i++) {
+    if (s.heap[i].owner == owner && (int32_t)(s.heap[i].due - latest) > 0) {
+      s.heap[i].due = latest;
+    }
+  }
+  schedHeapify(s);
+  schedFireDue(s);
+  schedArm(s);
+  restore_interrupts(saved);
+}
+
+// True if nothing is due before until (time_us_32 / micros)
+bool schedulerIdleUntil(Scheduler& s, uint32_t until) {
+  uint32_t saved = save_and_disable_interrupts();
+  bool idle = s.count == 0 || (int32_t)(s.heap[0].due - until) >= 0;
+  restore_interrupts(saved);
+  return idle;
+}
+
+bool schedulerPending(Scheduler& s, uint8_t owner) {
+  uint32_t saved = save_and_disable_interrupts();
+  bool found = false;
+  for (int i = 0; i < s.count && !found; i++) {
+    if (s.heap[i].owner == owner) found = true;
+  }
+  restore_interrupts(saved);
+  return found;
+}
+
+// loop() side: next fired event, if any
+bool schedulerPopFired(Scheduler& s, SchedEvent& e) {
+  if (s.firedTail == s.firedHead) return false;
+  __dmb();
+  e = s.fired[s.firedTail];
+  s.firedTail = (s.firedTail + 1) & (SCHED_FIRED_SIZE - 1);
+  return true;
+}
+
+#endif // SCHEDULER_V2_H
@@ -0,0 +1,234 @@
+#ifndef SETTINGS_JOURNAL_V2_H
+#define SETTINGS_JOURNAL_V2_H
+
+//================================ SETTINGS JOURNAL DEFINES ================================
+// Settings are saved write-behind: saveSettings() only marks them dirty and
+// updateSettingsJournal() writes them from loop() once they have been left
+// alone for SETTINGS_IDLE_MS. A flash program stalls both cores, so the
+// write also waits for a gap: nothing sounding, no loop file job running
+// and nothing due from the scheduler or the looper for SETTINGS_WRITE_MS.
+// Without a gap it is forced after SETTINGS_MAX_DEFER_MS - except while
+// the looper plays, where a forced write would be heard. Turning the
+// encoder through ten values costs one write, after the turning has stopped.
+//
+// The file is a journal of whole-settings records, appended one per commit:
+//   "ST", payload length (2 bytes), CRC-32 of the payload (4 bytes), payload
+// The payload is the tagged encoding from settingsSchemaV2.h ("SJ" records,
+// written by builds before it, hold a raw SettingsRawV1 and still load).
+// Loading is one streaming pass over the file with no heap: each record is
+// decoded field by field into a copy of the defaults on the stack while its
+// CRC is worked out, and only taken if the CRC checks out - the last good
+// record wins, so a write torn by a power cut leaves the previous settings.
+// Appending spreads the programs along the file instead of rewriting one
+// spot; once the journal reaches SETTINGS_JOURNAL_MAX_BYTES (or has a bad
+// or old-format record in it) it is compacted - the current record goes to a
+// new file that is then renamed over the journal, which LittleFS does
+// atomically.
+// Without a journal, the old raw /v2settings.bin is read once and migrated.
+// Needs settingsSchemaV2.h and LittleFS - include after them.
+
+#define SETTINGS_JOURNAL_PATH      "/v2settings.jnl"
+#define SETTINGS_JOURNAL_TMP_PATH  "/v2settings.tmp"
+#define SETTINGS_LEGACY_PATH       "/v2settings.bin"
+#define SETTINGS_JOURNAL_MAX_BYTES 4096     // Compact past this (one flash block)
+#define SETTINGS_RECORD_HEADER     8
+#define SETTINGS_RECORD_BYTES      (SETTINGS_RECORD_HEADER + SETTINGS_PAYLOAD_BYTES)
+#define SETTINGS_IDLE_MS           2000     // Unchanged this long before writing
+#define SETTINGS_MAX_DEFER_MS      30000    // Write even if notes are sounding after this
+#define SETTINGS_WRITE_MS          100      // Worst-case commit stall (a compaction erases a block)
+
+//================================ DATA STRUCTURES ================================
+
+struct SettingsJournal {
+  bool dirty = false;
+  unsigned long firstDirtyTime = 0;  // Oldest unsaved change
+  unsigned long lastDirtyTime = 0;   // Newest unsaved change
+  uint32_t journalBytes = 0;         // Valid bytes in the journal file
+  bool needsCompact = false;         // Bad record or failed append - rewrite on the next commit
+
+  // Counters
+  uint16_t commits = 0;
+  uint16_t compactions = 0;
+  uint16_t failures = 0;             // Writes that didn't complete
+  uint16_t badRecords = 0;           // Records skipped at load (torn writes)
+  uint16_t fieldsRefused = 0;        // Values out of range or unknown at load (defaults kept)
+};
+
+//================================ HELPERS ================================
+
+// CRC-32 (IEEE, as zlib) - bitwise, it runs once per commit or load.
+// Start from SETTINGS_CRC_INIT, feed the data in pieces, invert at the end.
+#define SETTINGS_CRC_INIT 0xFFFFFFFF
+
+uint32_t settingsCrc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return crc;
+}
+
+void settingsBuildRecord(uint8_t* out, const SettingsV2& s) {
+  uint16_t len = settingsEncode(out + SETTINGS_RECORD_HEADER, s);
+  uint32_t crc = ~settingsCrc32Update(SETTINGS_CRC_INIT, out + SETTINGS_RECORD_HEADER, len);
+  out[0] = 'S';
+  out[1] = 'T';
+  out[2] = len & 0xFF;
+  out[3] = len >> 8;
+  out[4] = crc & 0xFF;
+  out[5] = (crc >> 8) & 0xFF;
+  out[6] = (crc >> 16) & 0xFF;
+  out[7] = crc >> 24;
+}
+
+// Decode a tagged payload of len bytes from the file into s. False if the
+// CRC doesn't match or the payload is malformed (s is then partly written -
+// pass a scratch copy).
+bool settingsReadTagged(SettingsJournal& j, File& file, uint16_t len, uint32_t crc, SettingsV2& s) {
+  // The version byte isn't checked: tags keep their meaning across versions,
+  // so a newer payload still gives the fields this build knows
+  uint8_t version;
+  if (len < 1 || (len - 1) % SETTINGS_FIELD_BYTES != 0) return false;
+  if (file.read(&version, 1) != 1) return false;
+  uint32_t c = settingsCrc32Update(SETTINGS_CRC_INIT, &version, 1);
+
+  uint16_t refused = 0;
+  uint8_t field[SETTINGS_FIELD_BYTES];
+  for (uint16_t left = len - 1; left > 0; left -= SETTINGS_FIELD_BYTES) {
+    if (file.read(field, sizeof(field)) != sizeof(field)) return false;
+    c = settingsCrc32Update(c, field, sizeof(field));
+    if (!settingsDecodeField(s, field)) refused++;
+  }
+  if (~c != crc) return false;
+  j.fieldsRefused += refused;
+  return true;
+}
+
+// A raw SettingsRawV1 record from a build before the tagged format
+bool settingsReadRaw(SettingsJournal& j, File& file, uint16_t len, uint32_t crc, SettingsV2& s) {
+  SettingsRawV1 raw;
+  if (len != sizeof(raw) || file.read((uint8_t*)&raw, len) != len) return false;
+  if (~settingsCrc32Update(SETTINGS_CRC_INIT, (const uint8_t*)&raw, len) != crc) return false;
+  j.fieldsRefused += settingsDecodeLegacy(s, raw);
+  return true;
+}
+
+// Write the one record to a fresh file and rename it over the journal
+bool settingsJournalCompact(SettingsJournal& j, const SettingsV2& s) {
+  uint8_t record[SETTINGS_RECORD_BYTES];
+  settingsBuildRecord(record, s);
+
+  File file = LittleFS.open(SETTINGS_JOURNAL_TMP_PATH, "w");
+  if (!file) return false;
+  bool ok = file.write(record, sizeof(record)) == sizeof(record);
+  file.close();
+  if (!ok || !LittleFS.rename(SETTINGS_JOURNAL_TMP_PATH, SETTINGS_JOURNAL_PATH)) {
+    LittleFS.remove(SETTINGS_JOURNAL_TMP_PATH);
+    return false;
+  }
+
+  j.journalBytes = sizeof(record);
+  j.needsCompact = false;
+  j.compactions++;
+  return true;
+}
+
+bool settingsJournalAppend(SettingsJournal& j, const SettingsV2& s) {
+  uint8_t record[SETTINGS_RECORD_BYTES];
+  settingsBuildRecord(record, s);
+
+  File file = LittleFS.open(SETTINGS_JOURNAL_PATH, "a");
+  if (!file) return false;
+  size_t written = file.write(record, sizeof(record));
+  file.close();
+  if (written != sizeof(record)) {
+    j.needsCompact = true;  // A partial record is in the file now
+    return false;
+  }
+  j.journalBytes += sizeof(record);
+  return true;
+}
+
+//================================ PUBLIC API ================================
+
+// Read the newest good record into s. False if there is none (s untouched).
+bool settingsJournalLoad(SettingsJournal& j, SettingsV2& s) {
+  j.journalBytes = 0;
+  File file = LittleFS.open(SETTINGS_JOURNAL_PATH, "r");
+  if (!file) return false;
+
+  bool found = false;
+  size_t fileSize = file.size();
+  size_t pos = 0;
+  uint8_t header[SETTINGS_RECORD_HEADER];
+
+  while (pos + SETTINGS_RECORD_HEADER <= fileSize) {
+    if (file.read(header, sizeof(header)) != sizeof(header)) break;
+    bool tagged = header[0] == 'S' && header[1] == 'T';
+    bool raw = header[0] == 'S' && header[1] == 'J';
+    if (!tagged && !raw) break;  // Not a record - torn tail
+    uint16_t len = header[2] | (header[3] << 8);
+    uint32_t crc = header[4] | (header[5] << 8) | ((uint32_t)header[6] << 16) | ((uint32_t)header[7] << 24);
+    if (pos + SETTINGS_RECORD_HEADER + len > fileSize) break;  // Cut short
+
+    SettingsV2 candidate;  // Defaults for anything the record doesn't set
+    bool ok = tagged ? settingsReadTagged(j, file, len, crc, candidate)
+                     : settingsReadRaw(j, file, len, crc, candidate);
+    if (ok) {
+      s = candidate;
+      found = true;
+      if (raw) j.needsCompact = true;  // Rewrite in the tagged format
+    } else {
+      j.badRecords++;
+      j.needsCompact = true;
+      file.seek(pos + SETTINGS_RECORD_HEADER + len);
+    }
+    pos += SETTINGS_RECORD_HEADER + len;
+  }
+  file.close();
+
+  if (pos < fileSize) j.needsCompact = true;  // Trailing garbage - appends would land behind it
+  j.journalBytes = pos;
+  return found;
+}
+
+// Settings changed - written later by updateSettingsJournal
+void settingsJournalMarkDirty(SettingsJournal& j) {
+  unsigned long now = millis();
+  if (!j.dirty) j.firstDirtyTime = now;
+  j.lastDirtyTime = now;
+  j.dirty = true;
+}
+
+// Write now: append, or compact if the journal is full or damaged
+bool settingsJournalCommit(SettingsJournal& j, const SettingsV2& s) {
+  bool ok;
+  if (j.needsCompact || j.journalBytes + SETTINGS_RECORD_BYTES > SETTINGS_JOURNAL_MAX_BYTES) {
+    ok = settingsJournalCompact(j, s);
+  } else {
+    ok = settingsJournalAppend(j, s);
+  }
+  if (ok) {
+    j.dirty = false;
+    j.commits++;
+  } else {
+    j.failures++;
+    j.lastDirtyTime = millis();  // Try again after another idle period
+  }
+  return ok;
+}
+
+// Called from loop(). quiet: a gap of SETTINGS_WRITE_MS with nothing to
+// send and no other file work. mayForce: a write without a gap is allowed
+// once SETTINGS_MAX_DEFER_MS has passed.
+void updateSettingsJournal(SettingsJournal& j, const SettingsV2& s, bool quiet, bool mayForce) {
+  if (!j.dirty) return;
+  unsigned long now = millis();
+  if (now - j.lastDirtyTime < SETTINGS_IDLE_MS) return;
+  if (!quiet && (!mayForce || now - j.firstDirtyTime < SETTINGS_MAX_DEFER_MS)) return;
+  settingsJournalCommit(j, s);
+}
+
+#endif // SETTINGS_JOURNAL_V2_H
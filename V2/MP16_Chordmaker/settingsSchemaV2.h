@@ -0,0 +1,208 @@
+#ifndef SETTINGS_SCHEMA_V2_H
+#define SETTINGS_SCHEMA_V2_H
+
+#include <stddef.h>
+
+//================================ SETTINGS SCHEMA DEFINES ================================
+// On-flash settings are tagged, not a dump of SettingsV2, so the struct can
+// change between builds without old settings loading as garbage:
+//   schema version (1 byte), then per field: tag (1 byte), value (4 bytes LE,
+//   int32 / float bits / 0-1 for bools)
+// Each field has a permanent tag, a type and a valid range (settingsFields).
+// On load:
+//   - a field that's missing (saved by an older build) keeps its default -
+//     the value SettingsV2 initializes it with
+//   - a value outside its range is refused and the default kept
+//   - an unknown tag (saved by a newer build) is skipped
+// Rules for changing SettingsV2: add a field with a new tag, never reuse or
+// renumber a tag, and widen a range rather than narrowing it where possible.
+// Bump SETTINGS_SCHEMA_VERSION only when an existing tag changes meaning.
+//
+// SettingsRawV1 is the struct layout older firmware wrote raw to
+// /v2settings.bin - frozen, so those files still migrate field by field
+// (with the same range checks) after SettingsV2 changes.
+// Needs SettingsV2, NUM_SCALES, NUM_ARP_PATTERNS, NUM_ARP_OCTAVES - include after them.
+
+#define SETTINGS_SCHEMA_VERSION 1
+
+#define SETTINGS_TYPE_INT     0
+#define SETTINGS_TYPE_BOOL    1
+#define SETTINGS_TYPE_FLOAT   2
+
+#define SETTINGS_FIELD_BYTES  5       // Tag + value
+#define SETTINGS_NO_LEGACY    0xFF    // Field not in SettingsRawV1
+
+//================================ DATA STRUCTURES ================================
+
+// Layout of the raw settings dump written before the tagged format - do not change
+struct SettingsRawV1 {
+  int rootNote;
+  int scaleType;
+  int midiTrigChannel;
+  int midiOutputAChannel;
+  int midiOutputBChannel;
+  int midiOutputCChannel;
+  int midiOutputDChannel;
+  bool midiThru;
+  float velocityScaling;
+  int defaultVelocity;
+  int ledBrightness;
+  bool midiClockSync;
+  int internalBpm;
+  int arpPattern;
+  int arpGate;
+  int arpSwing;
+  int arpHumanize;
+  int arpVelocityVar;
+  int arpOctaveRange;
+  int maxNotesPerChord;
+  bool arpPlayChords;
+  int genMutationRate;
+  bool genScaleMode;
+  int screensaverTimeout;
+  int glideTime;
+  int glideType;
+  int glideMaxMs;
+  bool polyMode;
+};
+
+struct SettingsField {
+  uint8_t tag;
+  uint8_t type;                  // SETTINGS_TYPE_*
+  uint8_t offset;                // In SettingsV2
+  uint8_t legacyOffset;          // In SettingsRawV1, SETTINGS_NO_LEGACY if absent
+  float minValue;
+  float maxValue;
+};
+
+// A field that SettingsRawV1 also has (migrated from old raw files)
+#define SETTINGS_FIELD(tag, type, name, lo, hi) \
+  {tag, type, offsetof(SettingsV2, name), offsetof(SettingsRawV1, name), lo, hi}
+
+// A field added after the raw format - old files leave it at its default
+#define SETTINGS_FIELD_NEW(tag, type, name, lo, hi) \
+  {tag, type, offsetof(SettingsV2, name), SETTINGS_NO_LEGACY, lo, hi}
+
+// Tags are permanent - append new fields with the next free tag, using
+// SETTINGS_FIELD_NEW
+const SettingsField settingsFields[] = {
+  SETTINGS_FIELD(1,  SETTINGS_TYPE_INT,   rootNote,           24, 72),
+  SETTINGS_FIELD(2,  SETTINGS_TYPE_INT,   scaleType,          0, NUM_SCALES - 1),
+  SETTINGS_FIELD(3,  SETTINGS_TYPE_INT,   midiTrigChannel,    0, 15),
+  SETTINGS_FIELD(4,  SETTINGS_TYPE_INT,   midiOutputAChannel, 0, 15),
+  SETTINGS_FIELD(5,  SETTINGS_TYPE_INT,   midiOutputBChannel, 0, 15),
+  SETTINGS_FIELD(6,  SETTINGS_TYPE_INT,   midiOutputCChannel, 0, 15),
+  SETTINGS_FIELD(7,  SETTINGS_TYPE_INT,   midiOutputDChannel, 0, 15),
+  SETTINGS_FIELD(8,  SETTINGS_TYPE_BOOL,  midiThru,           0, 1),
+  SETTINGS_FIELD(9,  SETTINGS_TYPE_FLOAT, velocityScaling,    0.0f, 4.0f),
+  SETTINGS_FIELD(10, SETTINGS_TYPE_INT,   defaultVelocity,    1, 127),
+  SETTINGS_FIELD(11, SETTINGS_TYPE_INT,   ledBrightness,      0, 255),
+  SETTINGS_FIELD(12, SETTINGS_TYPE_BOOL,  midiClockSync,      0, 1),
+  SETTINGS_FIELD(13, SETTINGS_TYPE_INT,   internalBpm,        20, 300),
+  SETTINGS_FIELD(14, SETTINGS_TYPE_INT,   arpPattern,         0, NUM_ARP_PATTERNS - 1),
+  SETTINGS_FIELD(15, SETTINGS_TYPE_INT,   arpGate,            10, 100),
+  SETTINGS_FIELD(16, SETTINGS_TYPE_INT,   arpSwing,           0, 100),
+  SETTINGS_FIELD(17, SETTINGS_TYPE_INT,   arpHumanize,        0, 50),
+  SETTINGS_FIELD(18, SETTINGS_TYPE_INT,   arpVelocityVar,     0, 50),
+  SETTINGS_FIELD(19, SETTINGS_TYPE_INT,   arpOctaveRange,     0, NUM_ARP_OCTAVES - 1),
+  SETTINGS_FIELD(20, SETTINGS_TYPE_INT,   maxNotesPerChord,   1, 8),
+  SETTINGS_FIELD(21, SETTINGS_TYPE_BOOL,  arpPlayChords,      0, 1),
+  SETTINGS_FIELD(22, SETTINGS_TYPE_INT,   genMutationRate,    0, 100),
+  SETTINGS_FIELD(23, SETTINGS_TYPE_BOOL,  genScaleMode,       0, 1),
+  SETTINGS_FIELD(24, SETTINGS_TYPE_INT,   screensaverTimeout, 0, 3600),
+  SETTINGS_FIELD(25, SETTINGS_TYPE_INT,   glideTime,          0, 127),
+  SETTINGS_FIELD(26, SETTINGS_TYPE_INT,   glideType,          0, 1),
+  SETTINGS_FIELD(27, SETTINGS_TYPE_INT,   glideMaxMs,         500, 30000),
+  SETTINGS_FIELD(28, SETTINGS_TYPE_BOOL,  polyMode,           0, 1),
+};
+
+#define SETTINGS_FIELD_COUNT   (sizeof(settingsFields) / sizeof(settingsFields[0]))
+#define SETTINGS_PAYLOAD_BYTES (1 + SETTINGS_FIELD_COUNT * SETTINGS_FIELD_BYTES)
+
+//================================ FIELD ACCESS ================================
+
+// Store a value if it's in range (ints and bools arrive as floats, exact
+// for every range in the table). False (field untouched) if not.
+bool settingsFieldSet(const SettingsField& f, uint8_t* base, float value) {
+  if (!(value >= f.minValue && value <= f.maxValue)) return false;  // Also refuses NaN
+  uint8_t* p = base + f.offset;
+  switch (f.type) {
+    case SETTINGS_TYPE_BOOL:  *(bool*)p = value != 0; break;
+    case SETTINGS_TYPE_FLOAT: *(float*)p = value; break;
+    default:                  *(int*)p = (int)value; break;
+  }
+  return true;
+}
+
+const SettingsField* settingsFindField(uint8_t tag) {
+  for (size_t i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+    if (settingsFields[i].tag == tag) return &settingsFields[i];
+  }
+  return NULL;
+}
+
+//================================ ENCODE / DECODE ================================
+
+// Tagged payload for s; out must hold SETTINGS_PAYLOAD_BYTES. Returns the length.
+size_t settingsEncode(uint8_t* out, const SettingsV2& s) {
+  const uint8_t* base = (const uint8_t*)&s;
+  size_t n = 0;
+  out[n++] = SETTINGS_SCHEMA_VERSION;
+  for (size_t i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+    const SettingsField& f = settingsFields[i];
+    const uint8_t* p = base + f.offset;
+    uint32_t raw;
+    switch (f.type) {
+      case SETTINGS_TYPE_BOOL:  raw = *(const bool*)p ? 1 : 0; break;
+      case SETTINGS_TYPE_FLOAT: memcpy(&raw, p, 4); break;
+      default:                  raw = (uint32_t)*(const int*)p; break;
+    }
+    out[n++] = f.tag;
+    out[n++] = raw & 0xFF;
+    out[n++] = (raw >> 8) & 0xFF;
+    out[n++] = (raw >> 16) & 0xFF;
+    out[n++] = raw >> 24;
+  }
+  return n;
+}
+
+// One tag/value pair from a payload. False if it wasn't used (unknown tag
+// or out of range - s keeps what it had).
+bool settingsDecodeField(SettingsV2& s, const uint8_t field[SETTINGS_FIELD_BYTES]) {
+  const SettingsField* f = settingsFindField(field[0]);
+  if (!f) return false;
+  uint32_t raw = field[1] | (field[2] << 8) | ((uint32_t)field[3] << 16) | ((uint32_t)field[4] << 24);
+  float value;
+  if (f->type == SETTINGS_TYPE_FLOAT) {
+    memcpy(&value, &raw, 4);
+  } else {
+    value = (float)(int32_t)raw;
+  }
+  return settingsFieldSet(*f, (uint8_t*)&s, value);
+}
+
+// Fields of an old raw dump. Returns how many were refused.
+uint8_t settingsDecodeLegacy(SettingsV2& s, const SettingsRawV1& raw) {
+  const uint8_t* src = (const uint8_t*)&raw;
+  uint8_t refused = 0;
+  for (size_t i = 0; i < SETTINGS_FIELD_COUNT; i++) {
+    const SettingsField& f = settingsFields[i];
+    if (f.legacyOffset == SETTINGS_NO_LEGACY) continue;
+    const uint8_t* p = src + f.legacyOffset;
+    float value;
+    switch (f.type) {
+      case SETTINGS_TYPE_BOOL:  value = *p; break;  // Anything but 0/1 is refused
+      case SETTINGS_TYPE_FLOAT: memcpy(&value, p, 4); break;
+      default: {
+        int32_t v;
+        memcpy(&v, p, 4);
+        value = (float)v;
+        break;
+      }
+    }
+    if (!settingsFieldSet(f, (uint8_t*)&s, value)) refused++;
+  }
+  return refused;
+}
+
+#endif // SETTINGS_SCHEMA_V2_H
@@ -0,0 +1,173 @@
+#ifndef SMF_EXPORT_V2_H
+#define SMF_EXPORT_V2_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+//================================ SMF EXPORT DEFINES ================================
+// Turns recorded events into the event bytes of one MTrk, with the cleanup a
+// loop needs to make a valid file:
+//   - events arrive in tick order; each tick's events (SMF_EXPORT_BATCH at a
+//     time) are put in sub-tick order - overdubbing can leave a tick's
+//     events out of time order - keeping recording order for ties
+//   - a note-off without a note-on in the export (a note held across the
+//     loop point) is dropped
+//   - a note-on for a note that is already on closes it first
+//   - notes still on at the end are closed at endTime, then the track ends
+// Like smfV2.h there are no Arduino or file system dependencies: events come
+// from a source callback and bytes go to the caller's buffer, so the host
+// test (V2/hostTest/smfExportTest.cpp) checks the output byte for byte.
+// Needs smfV2.h - include after it.
+
+#define SMF_EXPORT_BATCH   32      // Events per tick sorted at a time
+
+// Phase
+#define SMF_EXPORT_EVENTS  0
+#define SMF_EXPORT_OFFS    1
+#define SMF_EXPORT_DONE    2
+
+//================================ DATA STRUCTURES ================================
+
+struct SmfExportEvent {
+  uint32_t tick;       // Source tick - nondecreasing from one event to the next
+  uint8_t subTick;     // Position within the tick, 0..subTicks-1
+  uint8_t status;      // Channel message with its channel; notes are 0x80 / 0x90 (0x90 is always a note-on)
+  uint8_t data1;
+  uint8_t data2;
+};
+
+// Next event; false at the end
+typedef bool (*SmfExportSource)(void* ctx, SmfExportEvent& e);
+
+struct SmfExportTrack {
+  SmfTrack smf;
+  SmfExportSource source = nullptr;
+  void* ctx = nullptr;
+  uint8_t subTicks = 1;          // SMF ticks per source tick
+  uint32_t endTime = 0;          // SMF tick where hanging notes close and the track ends
+  uint8_t phase = SMF_EXPORT_DONE;
+
+  uint8_t notesOn[16][16];       // Bit per channel/note sounding in the export
+  SmfExportEvent batch[SMF_EXPORT_BATCH];  // One tick's events, by sub-tick
+  uint8_t batchCount = 0;
+  uint8_t batchPos = 0;
+  SmfExportEvent carried;        // Read past the end of the last batch
+  bool hasCarried = false;
+  uint16_t offIndex = 0;         // Hanging note scan position (channel * 128 + note)
+};
+
+//================================ HELPERS ================================
+
+// Gather the next tick's events and sort them by sub-tick. False at the end.
+bool smfExportNextBatch(SmfExportTrack& x) {
+  x.batchCount = 0;
+  x.batchPos = 0;
+
+  SmfExportEvent e;
+  if (x.hasCarried) {
+    e = x.carried;
+    x.hasCarried = false;
+  } else if (!x.source || !x.source(x.ctx, e)) {
+    return false;
+  }
+  x.batch[x.batchCount++] = e;
+
+  while (x.source(x.ctx, e)) {
+    if (e.tick != x.batch[0].tick || x.batchCount >= SMF_EXPORT_BATCH) {
+      x.carried = e;
+      x.hasCarried = true;
+      break;
+    }
+    x.batch[x.batchCount++] = e;
+  }
+
+  // Insertion sort (stable, so same-time events keep recording order)
+  for (uint8_t i = 1; i < x.batchCount; i++) {
+    SmfExportEvent cur = x.batch[i];
+    uint8_t k = i;
+    while (k > 0 && x.batch[k - 1].subTick > cur.subTick) {
+      x.batch[k] = x.batch[k - 1];
+      k--;
+    }
+    x.batch[k] = cur;
+  }
+  return true;
+}
+
+//================================ PUBLIC API ================================
+
+// Start an MTrk in out and return its header bytes. Meta events (tempo...)
+// can be added through x.smf before the first smfExportStep.
+size_t smfExportBegin(SmfExportTrack& x, uint8_t* out, SmfExportSource source, void* ctx,
+                      uint8_t subTicks, uint32_t endTime) {
+  size_t n = smfBeginTrack(x.smf, out);
+  x.source = source;
+  x.ctx = ctx;
+  x.subTicks = subTicks;
+  x.endTime = endTime;
+  x.phase = SMF_EXPORT_EVENTS;
+  memset(x.notesOn, 0, sizeof(x.notesOn));
+  x.batchCount = 0;
+  x.batchPos = 0;
+  x.hasCarried = false;
+  x.offIndex = 0;
+  return n;
+}
+
+inline bool smfExportDone(const SmfExportTrack& x) {
+  return x.phase == SMF_EXPORT_DONE;
+}
+
+// Encode what comes next into out - at most SMF_MAX_EVENT_BYTES (a
+// retrigger's note-off and note-on). The end of track is the last thing
+// written; 0 after that.
+size_t smfExportStep(SmfExportTrack& x, uint8_t* out) {
+  while (x.phase == SMF_EXPORT_EVENTS) {
+    if (x.batchPos >= x.batchCount && !smfExportNextBatch(x)) {
+      x.offIndex = 0;
+      x.phase = SMF_EXPORT_OFFS;
+      break;
+    }
+    const SmfExportEvent& e = x.batch[x.batchPos++];
+    uint32_t when = e.tick * x.subTicks + e.subTick;
+    uint8_t command = e.status & 0xF0;
+    uint8_t ch = e.status & 0x0F;
+    if (command != 0x80 && command != 0x90) {
+      return smfEncodeChannel(x.smf, out, when, e.status, e.data1, e.data2);
+    }
+
+    uint8_t& bits = x.notesOn[ch][(e.data1 & 0x7F) >> 3];
+    uint8_t bit = 1 << (e.data1 & 7);
+    if (command == 0x80) {
+      if (!(bits & bit)) continue;  // Its note-on is before the loop point
+      bits &= ~bit;
+      return smfEncodeChannel(x.smf, out, when, 0x80 | ch, e.data1, e.data2);
+    }
+    size_t n = 0;
+    if (bits & bit) {
+      // Retrigger: close the previous one first
+      n += smfEncodeChannel(x.smf, out, when, 0x80 | ch, e.data1, 0);
+    }
+    bits |= bit;
+    n += smfEncodeChannel(x.smf, out + n, when, 0x90 | ch, e.data1, e.data2 ? e.data2 : 1);
+    return n;
+  }
+
+  if (x.phase == SMF_EXPORT_OFFS) {
+    // Close notes still on at the end, then end the track
+    while (x.offIndex < 16 * 128 &&
+           !(x.notesOn[x.offIndex >> 7][(x.offIndex & 0x7F) >> 3] & (1 << (x.offIndex & 7)))) {
+      x.offIndex++;
+    }
+    if (x.offIndex < 16 * 128) {
+      uint16_t i = x.offIndex++;
+      return smfEncodeChannel(x.smf, out, x.endTime, 0x80 | (i >> 7), i & 0x7F, 0);
+    }
+    x.phase = SMF_EXPORT_DONE;
+    return smfEncodeEndOfTrack(x.smf, out, x.endTime);
+  }
+  return 0;
+}
+
+#endif // SMF_EXPORT_V2_H
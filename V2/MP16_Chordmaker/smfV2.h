@@ -0,0 +1,153 @@
+#ifndef SMF_V2_H
+#define SMF_V2_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//================================ SMF DEFINES ================================
+// Standard MIDI File encoding, one event at a time into a caller's buffer.
+// No Arduino or file system dependencies - the sketch streams the bytes to
+// LittleFS, and the same code compiles on a desktop to check output.
+//   - header chunk: format 0 (one track) or 1 (conductor + tracks)
+//   - track chunk: written with a zero length, then patched once the track
+//     is finished (smfPatchTrackLength) - SmfTrack counts the bytes
+//   - channel events use running status; meta events cancel it
+// Every encode function returns the number of bytes written to out, which
+// must have room for SMF_MAX_EVENT_BYTES.
+
+#define SMF_HEADER_BYTES       14
+#define SMF_TRACK_HEADER_BYTES 8
+#define SMF_MAX_EVENT_BYTES    12      // 4-byte delta + largest event we emit
+
+#define SMF_FORMAT_SINGLE      0
+#define SMF_FORMAT_MULTI       1
+
+//================================ DATA STRUCTURES ================================
+
+struct SmfTrack {
+  uint32_t lastTick = 0;     // Absolute tick of the previous event
+  uint32_t length = 0;       // Bytes after the track header
+  uint8_t runningStatus = 0; // 0 = none
+};
+
+//================================ PRIMITIVES ================================
+
+inline size_t smfPutU16(uint8_t* out, uint16_t v) {
+  out[0] = v >> 8;
+  out[1] = v;
+  return 2;
+}
+
+inline size_t smfPutU32(uint8_t* out, uint32_t v) {
+  out[0] = v >> 24;
+  out[1] = v >> 16;
+  out[2] = v >> 8;
+  out[3] = v;
+  return 4;
+}
+
+// Variable-length quantity, 1-4 bytes (values up to 0x0FFFFFFF)
+inline size_t smfPutVarLen(uint8_t* out, uint32_t v) {
+  uint8_t tmp[4];
+  size_t n = 0;
+  v &= 0x0FFFFFFF;
+  do {
+    tmp[n++] = v & 0x7F;
+    v >>= 7;
+  } while (v);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = tmp[n - 1 - i] | (i + 1 < n ? 0x80 : 0);
+  }
+  return n;
+}
+
+//================================ CHUNKS ================================
+
+// MThd: format, track count, ticks per quarter note
+inline size_t smfWriteHeader(uint8_t* out, uint16_t format, uint16_t tracks, uint16_t division) {
+  out[0] = 'M'; out[1] = 'T'; out[2] = 'h'; out[3] = 'd';
+  smfPutU32(out + 4, 6);
+  smfPutU16(out + 8, format);
+  smfPutU16(out + 10, tracks);
+  smfPutU16(out + 12, division);
+  return SMF_HEADER_BYTES;
+}
+
+// MTrk with a placeholder length; resets the track's encoder
+inline size_t smfBeginTrack(SmfTrack& t, uint8_t* out) {
+  t = SmfTrack();
+  out[0] = 'M'; out[1] = 'T'; out[2] = 'r'; out[3] = 'k';
+  smfPutU32(out + 4, 0);
+  return SMF_TRACK_HEADER_BYTES;
+}
+
+// The 4 length bytes that go at (track header offset + 4)
+inline void smfPatchTrackLength(const SmfTrack& t, uint8_t out[4]) {
+  smfPutU32(out, t.length);
+}
+
+//================================ EVENTS ================================
+
+// Delta time from the previous event (ticks never go backwards)
+inline size_t smfPutDelta(SmfTrack& t, uint8_t* out, uint32_t tick) {
+  uint32_t delta = (tick > t.lastTick) ? tick - t.lastTick : 0;
+  if (tick > t.lastTick) t.lastTick = tick;
+  return smfPutVarLen(out, delta);
+}
+
+// Program change and channel pressure have one data byte, the rest two
+inline uint8_t smfDataBytes(uint8_t status) {
+  uint8_t command = status & 0xF0;
+  return (command == 0xC0 || command == 0xD0) ? 1 : 2;
+}
+
+// Any channel message - note on/off, CC, pitch bend... (data2 ignored when
+// the message has one data byte)
+inline size_t smfEncodeChannel(SmfTrack& t, uint8_t* out, uint32_t tick,
+                               uint8_t status, uint8_t data1, uint8_t data2) {
+  size_t n = smfPutDelta(t, out, tick);
+  if (status != t.runningStatus) {
+    out[n++] = status;
+    t.runningStatus = status;
+  }
+  out[n++] = data1 & 0x7F;
+  if (smfDataBytes(status) > 1) out[n++] = data2 & 0x7F;
+  t.length += n;
+  return n;
+}
+
+inline size_t smfEncodeMeta(SmfTrack& t, uint8_t* out, uint32_t tick,
+                            uint8_t type, const uint8_t* data, uint8_t len) {
+  size_t n = smfPutDelta(t, out, tick);
+  out[n++] = 0xFF;
+  out[n++] = type;
+  out[n++] = len;
+  for (uint8_t i = 0; i < len; i++) out[n++] = data[i];
+  t.runningStatus = 0;
+  t.length += n;
+  return n;
+}
+
+// FF 51: microseconds per quarter note
+inline size_t smfEncodeTempo(SmfTrack& t, uint8_t* out, uint32_t tick, uint32_t usPerQuarter) {
+  uint8_t d[3] = {(uint8_t)(usPerQuarter >> 16), (uint8_t)(usPerQuarter >> 8), (uint8_t)usPerQuarter};
+  return smfEncodeMeta(t, out, tick, 0x51, d, 3);
+}
+
+// FF 58: numerator, denominator as a power of 2, 24 clocks per click, 8 32nds per quarter
+inline size_t smfEncodeTimeSignature(SmfTrack& t, uint8_t* out, uint32_t tick,
+                                     uint8_t numerator, uint8_t denominatorPow2) {
+  uint8_t d[4] = {numerator, denominatorPow2, 24, 8};
+  return smfEncodeMeta(t, out, tick, 0x58, d, 4);
+}
+
+// FF 2F: end of track
+inline size_t smfEncodeEndOfTrack(SmfTrack& t, uint8_t* out, uint32_t tick) {
+  return smfEncodeMeta(t, out, tick, 0x2F, nullptr, 0);
+}
+
+inline uint32_t smfTempoFromBpm(uint16_t bpm) {
+  return bpm ? 60000000UL / bpm : 500000UL;
+}
+
+#endif // SMF_V2_H
@@ -151,8 +151,7 @@ void drawScreensaver(Adafruit_SSD1306& display, ScreensaverState& ss) {
       }
     }
   }
-
-  display.display();
+  // Caller flushes the buffer to the panel
 }
 
 #endif // SPECIAL_MODES_V2_H
@@ -0,0 +1,85 @@
+#ifndef UI_V2_H
+#define UI_V2_H
+
+#include <hardware/sync.h>
+
+//================================ UI SNAPSHOT DEFINES ================================
+// OLED and NeoPixel rendering run on core1 (setup1/loop1) so pixels.show()
+// and the I2C transfer never hold up MIDI, clock or arp on core0.
+// Core1 only ever reads a snapshot of the UI state, never the live globals:
+//   1. core1 decides a frame is due and asks for a snapshot (wanted)
+//   2. core0 copies the state into the back buffer on its next loop() pass
+//      and flips it to the front (fresh)
+//   3. core1 takes the front buffer and draws from it while core0 is free to
+//      fill the other one next time
+// Each flag has one writer per phase, so no locks are needed between cores.
+// Needs SettingsV2, RuntimeState, PadV2, CompiledChord and the looper -
+// include after them.
+
+//================================ DATA STRUCTURES ================================
+
+// Everything the renderers read
+struct UiSnapshot {
+  SettingsV2 settings;
+  RuntimeState state;
+  PadV2 pads[9];
+  CompiledChord activeChord;       // What state.activePad plays (if any)
+  LooperState looper;
+  LooperView looperView;           // Piano roll, copied while the looper screen shows
+  bool padStates[9];
+  bool keyStates[16];
+  bool shiftState;
+  bool screensaverActive;
+  bool externalClockActive;
+  bool clockPulseIndicator;
+  unsigned long lastClockPulseTime;
+  unsigned long lastMutationFlash;
+  int detectedBpm;
+  uint16_t clockBeatPhase;         // 0..65535 over the current beat (external clock)
+  uint32_t clockJitterUs;          // Tick arrival jitter (external clock)
+};
+
+struct UiSnapshotBuffer {
+  UiSnapshot buf[2];
+  volatile uint8_t front = 0;      // Last published buffer
+  volatile bool fresh = false;     // Published, not yet taken by core1
+  volatile bool wanted = false;    // Core1 is waiting for a new one
+  volatile bool enabled = false;   // Intro finished - core1 owns the display and LEDs
+};
+
+//================================ CORE 0 SIDE ================================
+
+// True when core1 is waiting for a snapshot
+inline bool uiSnapshotWanted(UiSnapshotBuffer& b) {
+  return b.wanted && !b.fresh;
+}
+
+// The buffer to fill - core1 isn't reading it
+inline UiSnapshot& uiSnapshotBack(UiSnapshotBuffer& b) {
+  return b.buf[b.front ^ 1];
+}
+
+// Make the filled back buffer the front
+inline void uiSnapshotPublish(UiSnapshotBuffer& b) {
+  __dmb();            // Contents visible to core1 before the flip
+  b.front ^= 1;
+  b.wanted = false;
+  __dmb();
+  b.fresh = true;
+}
+
+//================================ CORE 1 SIDE ================================
+
+// The newest snapshot, or NULL (and a request to core0) if there isn't one yet
+inline const UiSnapshot* uiSnapshotTake(UiSnapshotBuffer& b) {
+  if (!b.fresh) {
+    b.wanted = true;
+    return NULL;
+  }
+  __dmb();
+  const UiSnapshot* s = &b.buf[b.front];
+  b.fresh = false;
+  return s;
+}
+
+#endif // UI_V2_H
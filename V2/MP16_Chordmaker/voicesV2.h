@@ -0,0 +1,199 @@
+#ifndef VOICES_V2_H
+#define VOICES_V2_H
+
+//================================ VOICE TABLE DEFINES ================================
+// One entry per sounding note: the MIDI note and channel that were actually
+// sent, who owns it and when it started. Releasing a voice sends a note-off
+// for exactly that note/channel - it never recomputes the pitch, so changing
+// root or octave while a pad is held can't leave a note stuck.
+//   - pad voices are indexed by (pad, chord note index), so stopNote() is O(1)
+//   - the same note on the same channel from two owners is retriggered on
+//     start and only released when the last owner lets go (as the old
+//     per-channel reference counts did)
+//   - arp notes are sent by the scheduler; their voices are tracked after the
+//     fact (voiceTrack/voiceForget) so panic knows about them
+//   - panic walks the live voices only
+// When the table is full the oldest voice is released to make room.
+
+#define VOICE_MAX            48      // Simultaneous voices
+#define VOICE_SLOTS          8       // Notes per chord
+
+// Owners: pads 0-8, then arp and looper tracks
+#define VOICE_OWNER_PADS     9
+#define VOICE_OWNER_ARP      9
+#define VOICE_OWNER_LOOPER   10      // First looper track; track n is VOICE_OWNER_LOOPER + n
+#define VOICE_NO_SLOT        0xFF
+
+//================================ DATA STRUCTURES ================================
+
+struct Voice {
+  uint8_t note;          // As sent
+  uint8_t channel;       // 0-15, as sent
+  uint8_t owner;         // Pad index or VOICE_OWNER_*
+  uint8_t slot;          // Chord note index for pads, VOICE_NO_SLOT otherwise
+  uint32_t startTime;    // millis()
+};
+
+struct VoiceTable {
+  Voice voices[VOICE_MAX];            // Live voices are [0, count)
+  uint8_t count = 0;
+  int8_t padSlot[VOICE_OWNER_PADS][VOICE_SLOTS];  // Index into voices, -1 = silent
+
+  // Counters
+  uint16_t steals = 0;                // Voices released early because the table was full
+};
+
+// Defined in the main sketch
+extern void sendNoteOn(int note, int velocity, int channel, int pad);
+extern void sendNoteOff(int note, int velocity, int channel, int pad);
+
+//================================ HELPERS ================================
+
+void voicesInit(VoiceTable& t) {
+  t.count = 0;
+  for (int p = 0; p < VOICE_OWNER_PADS; p++) {
+    for (int s = 0; s < VOICE_SLOTS; s++) {
+      t.padSlot[p][s] = -1;
+    }
+  }
+}
+
+inline bool voiceHasSlot(uint8_t owner, uint8_t slot) {
+  return owner < VOICE_OWNER_PADS && slot < VOICE_SLOTS;
+}
+
+// Source pad sent along with the note (looper recording), -1 for arp/looper
+inline int voicePad(uint8_t owner) {
+  return (owner < VOICE_OWNER_PADS) ? owner : -1;
+}
+
+// Any voice sounding this note on this channel
+bool voiceSounding(VoiceTable& t, uint8_t note, uint8_t channel) {
+  for (int i = 0; i < t.count; i++) {
+    if (t.voices[i].note == note && t.voices[i].channel == channel) return true;
+  }
+  return false;
+}
+
+int voiceFind(VoiceTable& t, uint8_t owner, uint8_t note, uint8_t channel) {
+  for (int i = 0; i < t.count; i++) {
+    const Voice& v = t.voices[i];
+    if (v.owner == owner && v.note == note && v.channel == channel) return i;
+  }
+  return -1;
+}
+
+// Drop entry i (last entry moves into its place). Sends nothing.
+void voiceRemoveAt(VoiceTable& t, uint8_t i) {
+  Voice& v = t.voices[i];
+  if (voiceHasSlot(v.owner, v.slot)) t.padSlot[v.owner][v.slot] = -1;
+
+  t.count--;
+  if (i == t.count) return;
+  t.voices[i] = t.voices[t.count];
+  Voice& moved = t.voices[i];
+  if (voiceHasSlot(moved.owner, moved.slot)) t.padSlot[moved.owner][moved.slot] = i;
+}
+
+// Release entry i: note-off unless another owner still holds the same note
+void voiceStopAt(VoiceTable& t, uint8_t i) {
+  uint8_t note = t.voices[i].note;
+  uint8_t channel = t.voices[i].channel;
+  int pad = voicePad(t.voices[i].owner);
+  voiceRemoveAt(t, i);
+  if (!voiceSounding(t, note, channel)) {
+    sendNoteOff(note, 0, channel, pad);
+  }
+}
+
+// New entry (sends nothing); steals the oldest voice if the table is full
+int voiceAdd(VoiceTable& t, uint8_t owner, uint8_t slot, uint8_t note, uint8_t channel) {
+  if (t.count >= VOICE_MAX) {
+    uint8_t oldest = 0;
+    for (int i = 1; i < t.count; i++) {
+      if ((int32_t)(t.voices[i].startTime - t.voices[oldest].startTime) < 0) oldest = i;
+    }
+    voiceStopAt(t, oldest);
+    t.steals++;
+  }
+  uint8_t i = t.count++;
+  Voice& v = t.voices[i];
+  v.note = note;
+  v.channel = channel;
+  v.owner = owner;
+  v.slot = slot;
+  v.startTime = millis();
+  if (voiceHasSlot(owner, slot)) t.padSlot[owner][slot] = i;
+  return i;
+}
+
+//================================ PUBLIC API ================================
+
+// Play a note for an owner (slot = chord note index for pads)
+void voiceStart(VoiceTable& t, uint8_t owner, uint8_t slot, uint8_t note, uint8_t velocity, uint8_t channel) {
+  // This owner's previous voice here still sounding - release it first
+  int prev = voiceHasSlot(owner, slot) ? t.padSlot[owner][slot] : voiceFind(t, owner, note, channel);
+  if (prev >= 0) {
+    voiceStopAt(t, prev);
+  }
+  // Someone else holds this note - retrigger
+  if (voiceSounding(t, note, channel)) {
+    sendNoteOff(note, 0, channel, voicePad(owner));
+  }
+  voiceAdd(t, owner, slot, note, channel);
+  sendNoteOn(note, velocity, channel, voicePad(owner));
+}
+
+// Release one pad note - O(1)
+void voiceStopSlot(VoiceTable& t, uint8_t owner, uint8_t slot) {
+  if (!voiceHasSlot(owner, slot)) return;
+  int8_t i = t.padSlot[owner][slot];
+  if (i >= 0) voiceStopAt(t, i);
+}
+
+// Release an owner's voice by note (arp/looper). False if it wasn't sounding.
+bool voiceStopNote(VoiceTable& t, uint8_t owner, uint8_t note, uint8_t channel) {
+  int i = voiceFind(t, owner, note, channel);
+  if (i < 0) return false;
+  voiceStopAt(t, i);
+  return true;
+}
+
+// Record a note-on/off that was sent elsewhere (scheduler)
+void voiceTrack(VoiceTable& t, uint8_t owner, uint8_t note, uint8_t channel) {
+  voiceAdd(t, owner, VOICE_NO_SLOT, note, channel);
+}
+
+void voiceForget(VoiceTable& t, uint8_t owner, uint8_t note, uint8_t channel) {
+  int i = voiceFind(t, owner, note, channel);
+  if (i >= 0) voiceRemoveAt(t, i);
+}
+
+// Drop an owner's voices without sending (their note-offs already went out)
+void voicesForgetOwner(VoiceTable& t, uint8_t owner) {
+  for (int i = t.count - 1; i >= 0; i--) {
+    if (t.voices[i].owner == owner) voiceRemoveAt(t, i);
+  }
+}
+
+// Release all of one owner's voices (looper track muted/cleared)
+void voicesStopOwner(VoiceTable& t, uint8_t owner) {
+  for (int i = t.count - 1; i >= 0; i--) {
+    if (t.voices[i].owner == owner) voiceStopAt(t, i);
+  }
+}
+
+// Note-off for every live voice, then empty the table
+void voicesPanic(VoiceTable& t) {
+  for (int i = 0; i < t.count; i++) {
+    const Voice& v = t.voices[i];
+    bool first = true;  // One note-off per note/channel
+    for (int j = 0; j < i && first; j++) {
+      if (t.voices[j].note == v.note && t.voices[j].channel == v.channel) first = false;
+    }
+    if (first) sendNoteOff(v.note, 0, v.channel, voicePad(v.owner));
+  }
+  voicesInit(t);
+}
+
+#endif // VOICES_V2_H
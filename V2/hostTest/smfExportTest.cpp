@@ -0,0 +1,127 @@
+// Host check for the loop MIDI export (smfV2.h + smfExportV2.h) - byte for
+// byte against hand-encoded tracks. Builds with any desktop compiler:
+//   g++ -std=c++11 -I../MP16_Chordmaker smfExportTest.cpp -o smfExportTest && ./smfExportTest
+// Exit code 0 = all passed.
+
+#include <stdio.h>
+#include "smfV2.h"
+#include "smfExportV2.h"
+
+//================================ HARNESS ================================
+
+int failures = 0;
+
+struct ListSource {
+  const SmfExportEvent* events;
+  size_t count;
+  size_t pos;
+};
+
+bool listNext(void* ctx, SmfExportEvent& e) {
+  ListSource& s = *(ListSource*)ctx;
+  if (s.pos >= s.count) return false;
+  e = s.events[s.pos++];
+  return true;
+}
+
+// Whole MTrk for events, length patched in. Returns its size.
+size_t exportTrack(const SmfExportEvent* events, size_t count, uint8_t subTicks,
+                   uint32_t endTime, uint8_t* out) {
+  ListSource src = {events, count, 0};
+  SmfExportTrack x;
+  size_t n = smfExportBegin(x, out, listNext, &src, subTicks, endTime);
+  while (!smfExportDone(x)) {
+    size_t step = smfExportStep(x, out + n);
+    if (step > SMF_MAX_EVENT_BYTES) {
+      printf("FAIL step of %u bytes (caller's buffer has room for %d)\n", (unsigned)step, SMF_MAX_EVENT_BYTES);
+      failures++;
+    }
+    n += step;
+  }
+  smfPatchTrackLength(x.smf, out + 4);
+  return n;
+}
+
+void expectBytes(const char* name, const uint8_t* got, size_t gotLen,
+                 const uint8_t* want, size_t wantLen) {
+  bool same = gotLen == wantLen;
+  for (size_t i = 0; same && i < wantLen; i++) same = got[i] == want[i];
+  printf("%s %s\n", same ? "ok  " : "FAIL", name);
+  if (same) return;
+  failures++;
+  printf("  want:");
+  for (size_t i = 0; i < wantLen; i++) printf(" %02X", want[i]);
+  printf("\n  got: ");
+  for (size_t i = 0; i < gotLen; i++) printf(" %02X", got[i]);
+  printf("\n");
+}
+
+//================================ TESTS ================================
+
+// Sub-tick sorting, orphan note-off, retrigger, running status, hanging notes
+void testLoopCleanup() {
+  const SmfExportEvent events[] = {
+    {0, 10, 0x90, 60, 100},   // Recorded after the CC but earlier in the tick...
+    {0, 5,  0xB0, 1,  64},    // ...so the CC goes first
+    {0, 0,  0x80, 62, 0},     // Note-off from before the loop point: dropped
+    {1, 0,  0x90, 60, 0},     // Retrigger (velocity 0 written as 1)
+    {2, 20, 0x80, 60, 64},
+    {3, 0,  0x90, 64, 100},   // Both still on at the end
+    {3, 0,  0x90, 67, 100},
+  };
+  const uint8_t want[] = {
+    'M', 'T', 'r', 'k', 0x00, 0x00, 0x00, 0x26,
+    0x05, 0xB0, 0x01, 0x40,   //   5: CC 1
+    0x05, 0x90, 0x3C, 0x64,   //  10: note-on 60
+    0x1E, 0x80, 0x3C, 0x00,   //  40: retrigger closes 60...
+    0x00, 0x90, 0x3C, 0x01,   //      ...and starts it again
+    0x3C, 0x80, 0x3C, 0x40,   // 100: note-off 60
+    0x14, 0x90, 0x40, 0x64,   // 120: note-on 64
+    0x00, 0x43, 0x64,         //      note-on 67 (running status)
+    0x28, 0x80, 0x40, 0x00,   // 160: hanging 64 closed at the end
+    0x00, 0x43, 0x00,         //      hanging 67
+    0x00, 0xFF, 0x2F, 0x00,   //      end of track
+  };
+  uint8_t out[256];
+  size_t n = exportTrack(events, sizeof(events) / sizeof(events[0]), 40, 160, out);
+  expectBytes("loop cleanup", out, n, want, sizeof(want));
+}
+
+// More events in one tick than a batch holds: each batch is sorted on its own
+void testBatchOverflow() {
+  SmfExportEvent events[SMF_EXPORT_BATCH + 1];
+  for (int i = 0; i < SMF_EXPORT_BATCH; i++) {
+    events[i] = {0, 1, 0xB0, 7, (uint8_t)i};
+  }
+  events[SMF_EXPORT_BATCH] = {0, 0, 0xB0, 7, 127};  // Next batch - can't move ahead of the rest
+  uint8_t want[8 + 4 + 3 * (SMF_EXPORT_BATCH - 1) + 3 + 4];
+  size_t n = 0;
+  const uint8_t header[] = {'M', 'T', 'r', 'k', 0, 0, 0, sizeof(want) - 8};
+  for (uint8_t b : header) want[n++] = b;
+  want[n++] = 0x01; want[n++] = 0xB0; want[n++] = 0x07; want[n++] = 0x00;
+  for (int i = 1; i < SMF_EXPORT_BATCH; i++) {
+    want[n++] = 0x00; want[n++] = 0x07; want[n++] = (uint8_t)i;
+  }
+  want[n++] = 0x00; want[n++] = 0x07; want[n++] = 0x7F;  // Ticks never go backwards
+  want[n++] = 0x01; want[n++] = 0xFF; want[n++] = 0x2F; want[n++] = 0x00;
+
+  uint8_t out[256];
+  size_t got = exportTrack(events, SMF_EXPORT_BATCH + 1, 4, 2, out);
+  expectBytes("batch overflow", out, got, want, n);
+}
+
+// Nothing recorded: just the end of track at the loop length
+void testEmpty() {
+  const uint8_t want[] = {'M', 'T', 'r', 'k', 0, 0, 0, 0x05, 0x83, 0x60, 0xFF, 0x2F, 0x00};
+  uint8_t out[32];
+  size_t n = exportTrack(nullptr, 0, 40, 480, out);
+  expectBytes("empty track", out, n, want, sizeof(want));
+}
+
+int main() {
+  testLoopCleanup();
+  testBatchOverflow();
+  testEmpty();
+  printf(failures ? "%d failed\n" : "all passed\n", failures);
+  return failures ? 1 : 0;
+}